@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "cista/mmap.h"
+
+#include "utl/parser/cstr.h"
+
+#include "chessbot/eval.h"
+#include "chessbot/generate_moves.h"
+#include "chessbot/nn_accumulator.h"
+#include "chessbot/nn_chess.h"
+#include "chessbot/nn_quantized.h"
+#include "chessbot/pgn.h"
+#include "chessbot/position.h"
+#include "chessbot/see.h"
+#include "chessbot/timing.h"
+#include "chessbot/util.h"
+#include "chessbot/zobrist.h"
+
+using namespace chessbot;
+
+constexpr auto const embedded_pgns = R"([Event "Paris"]
+[Site "Opera"]
+
+1. e4 e5 2. Nf3 d6 3. d4 Bg4 4. dxe5 Bxf3 5. Qxf3 dxe5 6. Bc4 Nf6 7. Qb3 Qe7
+8. Nc3 c6 9. Bg5 b5 10. Nxb5 cxb5 11. Bxb5+ Nbd7 12. O-O-O Rd8 13. Rxd7 Rxd7
+14. Rd1 Qe6 15. Bxd7+ Nxd7 16. Qb8+ Nxb8 17. Rd8# 1-0
+
+[Event "London"]
+[Site "Immortal"]
+
+1. e4 e5 2. f4 exf4 3. Bc4 Qh4+ 4. Kf1 b5 5. Bxb5 Nf6 6. Nf3 Qh6 7. d3 Nh5
+8. Nh4 Qg5 9. Nf5 c6 10. g4 Nf6 11. Rg1 cxb5 12. h4 Qg6 13. h5 Qg5 14. Qf3 Ng8
+15. Bxf4 Qf6 16. Nc3 Bc5 17. Nd5 Qxb2 18. Bd6 Bxg1 19. e5 Qxa1+ 20. Ke2 Na6
+21. Nxg7+ Kd8 22. Qf6+ Nxf6 23. Be7# 1-0
+
+[Event "Rated Classical tournament"]
+[Site "https://lichess.org/z0CDaIfk"]
+
+1. d4 d5 2. Nf3 Nf6 3. e3 c5 4. c3 Nc6 5. Bd3 cxd4 6. cxd4 Bg4 7. a3 e5 8. Be2
+e4 9. Ng5 h5 10. f4 exf3 11. Bxf3 Ne4 12. Nxe4 dxe4 13. Bxg4 hxg4 14. Qxg4 Rh4
+15. Qe2 Qg5 16. g3 Rh3 17. Nd2 f5 18. Nc4 O-O-O 19. Bd2 b5 20. Ne5 Nxe5
+21. dxe5 a6 22. O-O-O Rh6 23. Kb1 Rc6 24. Rc1 Kb7 25. Ba5 Rdc8 26. Rc3 Rxc3
+27. Bxc3 Bxa3 28. Qd2 Bc5 29. Qd7+ Rc7 30. Qd5+ Kb6 31. Bd4 Qe7 32. Rc1 g5
+33. b4 Bxd4 34. Qxd4+ Kb7 35. Qd5+ Kb8 36. Qg8+ Ka7 37. Rxc7+ Qxc7 38. Qxg5
+Qxe5 39. Qd8 Qc3 40. Qd4+ Qxd4 41. exd4 Kb6 42. Kc2 a5 43. bxa5+ Kxa5 44. Kc3
+b4+ 45. Kb3 e3 46. Kc2 e2 47. Kd2 b3 48. d5 b2 49. d6 b1=Q 50. d7 e1=Q# 0-1
+)";
+
+// Position before a game move and the move itself.
+struct sample {
+  position p_;
+  move m_;
+};
+
+void add_games(utl::cstr pgn, size_t const max_games,
+               unsigned const random_plies, std::vector<sample>& corpus) {
+  auto n_games = size_t{0U};
+  while (n_games != max_games) {
+    pgn = pgn.skip_whitespace_front();
+    if (pgn.empty()) {
+      break;
+    }
+    auto const g = parse_pgn(pgn);
+    ++n_games;
+
+    try {
+      auto p = position::from_fen(start_position_fen);
+      for (auto const& pgn_move : g.moves_) {
+        auto const before = p;
+        auto const s = p.make_pgn_move(pgn_move, nullptr);
+        corpus.emplace_back(sample{before, s.last_move_});
+
+        // Random continuations add positions that are not in the games.
+        auto random_pos = p;
+        for (auto i = 0U; i != random_plies; ++i) {
+          std::array<move, max_moves> move_list;
+          auto const end = generate_moves(random_pos, &move_list[0]);
+          auto const n = static_cast<size_t>(end - &move_list[0]);
+          if (n == 0U) {
+            break;
+          }
+          auto const m = move_list[get_random_number() % n];
+          corpus.emplace_back(sample{random_pos, m});
+          random_pos.make_move(m, nullptr);
+        }
+      }
+    } catch (std::exception const& e) {
+      std::cerr << "skipping game " << g.header_.site_ << ": " << e.what()
+                << "\n";
+    }
+  }
+}
+
+// Keeps results alive so the compiler can't drop the measured work.
+size_t sink = 0U;
+
+struct bench_config {
+  unsigned warmup_{2U}, reps_{20U};
+  std::string_view filter_;
+};
+
+// One sample = average ns/op over one pass over the corpus.
+template <typename Fn>
+void bench(bench_config const& config, char const* name, size_t const n_ops,
+           Fn&& pass) {
+  if (!config.filter_.empty() &&
+      std::string_view{name}.find(config.filter_) == std::string_view::npos) {
+    return;
+  }
+
+  for (auto i = 0U; i != config.warmup_; ++i) {
+    pass();
+  }
+
+  auto samples = std::vector<double>{};
+  for (auto i = 0U; i != config.reps_; ++i) {
+    CHESSBOT_START_TIMING(pass);
+    pass();
+    CHESSBOT_STOP_TIMING(pass);
+    samples.emplace_back(
+        std::chrono::duration<double, std::nano>(pass_stop - pass_start)
+            .count() /
+        n_ops);
+  }
+
+  std::sort(begin(samples), end(samples));
+  auto const percentile = [&](double const q) {
+    return samples[std::min(samples.size() - 1U,
+                            static_cast<size_t>(q * samples.size()))];
+  };
+  printf("%-28s %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+         std::accumulate(begin(samples), end(samples), 0.0) / samples.size(),
+         samples.front(), percentile(0.5), percentile(0.9), percentile(0.99));
+}
+
+int main(int argc, char** argv) {
+  auto config = bench_config{};
+  auto max_games = std::numeric_limits<size_t>::max();
+  auto random_plies = 4U;
+  auto pgn_path = static_cast<char const*>(nullptr);
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--pgn" && i + 1 < argc) {
+      pgn_path = argv[++i];
+    } else if (arg == "--games" && i + 1 < argc) {
+      max_games = std::stoul(argv[++i]);
+    } else if (arg == "--random-plies" && i + 1 < argc) {
+      random_plies = std::stoul(argv[++i]);
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      config.warmup_ = std::stoul(argv[++i]);
+    } else if (arg == "--reps" && i + 1 < argc) {
+      config.reps_ = std::max(1UL, std::stoul(argv[++i]));
+    } else if (arg == "--filter" && i + 1 < argc) {
+      config.filter_ = argv[++i];
+    } else {
+      std::cout << "usage: " << argv[0]
+                << " [--pgn FILE] [--games N] [--random-plies N] [--warmup N] "
+                   "[--reps N] [--filter NAME]\n";
+      return 1;
+    }
+  }
+
+  auto corpus = std::vector<sample>{};
+  if (pgn_path != nullptr) {
+    auto m = cista::mmap{pgn_path, cista::mmap::protection::READ};
+    add_games(utl::cstr{m.data(), m.size()}, max_games, random_plies, corpus);
+  } else {
+    add_games(utl::cstr{embedded_pgns}, max_games, random_plies, corpus);
+  }
+  if (corpus.empty()) {
+    std::cout << "empty corpus\n";
+    return 1;
+  }
+
+  auto fens = std::vector<std::string>{};
+  for (auto const& s : corpus) {
+    fens.emplace_back(s.p_.to_fen());
+  }
+
+  // State right before update_blockers_and_pinners is called in make_move:
+  // pieces moved, side to move and pins not yet updated.
+  auto before_update = std::vector<position>{};
+  for (auto const& s : corpus) {
+    auto& p = before_update.emplace_back(s.p_);
+    p.make_move(s.m_, nullptr);
+    p.to_move_ = s.p_.to_move_;
+    p.checkers_ = s.p_.checkers_;
+    p.blockers_for_king_ = s.p_.blockers_for_king_;
+    p.pinners_ = s.p_.pinners_;
+  }
+
+  printf("corpus: %zu positions, warmup %u, reps %u\n", corpus.size(),
+         config.warmup_, config.reps_);
+  printf("%-28s %10s %10s %10s %10s %10s\n", "ns/op", "mean", "min", "p50",
+         "p90", "p99");
+
+  auto const n = corpus.size();
+  bench(config, "make_move (copy)", n, [&]() {
+    for (auto const& s : corpus) {
+      auto p = s.p_;
+      p.make_move(s.m_, nullptr);
+      sink += p.hash_;
+    }
+  });
+
+  auto work = std::vector<position>{};
+  for (auto const& s : corpus) {
+    work.emplace_back(s.p_);
+  }
+  bench(config, "make_move + unmake_move", n, [&]() {
+    for (auto i = 0U; i != n; ++i) {
+      auto const s = work[i].make_move(corpus[i].m_, nullptr);
+      sink += work[i].hash_;
+      work[i].unmake_move(corpus[i].m_, s);
+    }
+  });
+
+  bench(config, "update_blockers_and_pinners", n, [&]() {
+    for (auto i = 0U; i != n; ++i) {
+      auto p = before_update[i];
+      p.update_blockers_and_pinners(corpus[i].m_, corpus[i].p_.en_passant_);
+      sink += p.blockers_for_king_[0] ^ p.checkers_[1];
+    }
+  });
+
+  bench(config, "generate_moves", n, [&]() {
+    std::array<move, max_moves> move_list;
+    for (auto const& s : corpus) {
+      sink += static_cast<size_t>(generate_moves(s.p_, &move_list[0]) -
+                                  &move_list[0]);
+    }
+  });
+
+  bench(config, "count_moves", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += count_moves(s.p_);
+    }
+  });
+
+  bench(config, "compute_hash", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += compute_hash(s.p_);
+    }
+  });
+
+  bench(config, "tapered_eval (incremental)", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += static_cast<size_t>(tapered_eval(s.p_));
+    }
+  });
+
+  bench(config, "compute_psq (full scan)", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += static_cast<size_t>(compute_psq(s.p_).mg_);
+    }
+  });
+
+  bench(config, "position::from_fen", n, [&]() {
+    for (auto const& fen : fens) {
+      sink += position::from_fen(fen).hash_;
+    }
+  });
+
+  bench(config, "position::parse_fen", n, [&]() {
+    for (auto const& fen : fens) {
+      sink += position::parse_fen(fen).hash_;
+    }
+  });
+
+  bench(config, "operator>> (stringstream)", n, [&]() {
+    for (auto const& fen : fens) {
+      auto in = std::stringstream{fen};
+      auto p = position{};
+      in >> p;
+      sink += p.hash_;
+    }
+  });
+
+  bench(config, "position::to_fen", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += s.p_.to_fen().size();
+    }
+  });
+
+  bench(config, "position::to_fen(char*)", n, [&]() {
+    char buf[position::max_fen_length];
+    for (auto const& s : corpus) {
+      sink += static_cast<size_t>(s.p_.to_fen(buf) - buf);
+    }
+  });
+
+  // All captures and promotions of the corpus positions.
+  auto captures = std::vector<sample>{};
+  for (auto const& s : corpus) {
+    std::array<move, max_moves> move_list;
+    auto const end = generate_moves<gen_type::CAPTURES>(s.p_, &move_list[0]);
+    for (auto it = &move_list[0]; it != end; ++it) {
+      captures.emplace_back(sample{s.p_, *it});
+    }
+  }
+
+  bench(config, "see", captures.size(), [&]() {
+    for (auto const& s : captures) {
+      sink += static_cast<size_t>(see(s.p_, s.m_));
+    }
+  });
+
+  bench(config, "see_ge", captures.size(), [&]() {
+    for (auto const& s : captures) {
+      sink += see_ge(s.p_, s.m_, 0) ? 1U : 0U;
+    }
+  });
+
+  // Network evaluation of all children of the corpus positions, as in a
+  // search: full input rebuild vs. incremental accumulator.
+  using nn_t = network<input_size, 16, 16, output_size>;
+  auto const nn = std::make_unique<nn_t>();
+  auto acc = nn_accumulator<nn_t>{*nn};
+  auto children = std::vector<position>{};
+  auto child_moves = std::vector<std::vector<move>>{};
+  for (auto const& s : corpus) {
+    std::array<move, max_moves> move_list;
+    auto const end = generate_moves(s.p_, &move_list[0]);
+    child_moves.emplace_back(&move_list[0], end);
+    for (auto const m : child_moves.back()) {
+      children.emplace_back(s.p_).make_move(m, nullptr);
+    }
+  }
+
+  bench(config, "nn first layer (full)", children.size(), [&]() {
+    for (auto const& p : children) {
+      sink += static_cast<size_t>(
+          std::get<0>(nn->layers_).net(nn_input_from_position(p))[0]);
+    }
+  });
+
+  bench(config, "nn first layer (sparse)", children.size(), [&]() {
+    for (auto const& p : children) {
+      sink += static_cast<size_t>(std::get<0>(nn->layers_).net(
+          nn_sparse_input_from_position(p), 1.0)[0]);
+    }
+  });
+
+  bench(config, "nn first layer (acc)", children.size(), [&]() {
+    for (auto i = 0U; i != corpus.size(); ++i) {
+      auto p = corpus[i].p_;
+      acc.reset(p);
+      for (auto const m : child_moves[i]) {
+        acc.push(p, m);
+        sink += static_cast<size_t>(acc.net(p.opposing_color())[0]);
+        acc.pop();
+      }
+    }
+  });
+
+  bench(config, "network::estimate (full)", children.size(), [&]() {
+    for (auto const& p : children) {
+      sink += static_cast<size_t>(nn->estimate(nn_input_from_position(p))[0]);
+    }
+  });
+
+  bench(config, "network::estimate (acc)", children.size(), [&]() {
+    for (auto i = 0U; i != corpus.size(); ++i) {
+      auto p = corpus[i].p_;
+      acc.reset(p);
+      for (auto const m : child_moves[i]) {
+        acc.push(p, m);
+        sink += static_cast<size_t>(acc.estimate(p.opposing_color())[0]);
+        acc.pop();
+      }
+    }
+  });
+
+  // One training sample (forward, backward, gradient accumulation).
+  auto expected = nn_t::output_t{};
+  for (auto i = 0U; i < expected.size(); i += 7U) {
+    expected[i] = 1.0;
+  }
+  auto const gradient = std::make_unique<nn_t::layers_tuple_t>();
+
+  bench(config, "nn train (dense input)", n, [&]() {
+    for (auto const& s : corpus) {
+      nn->train(*gradient, nn_input_from_position(s.p_), expected, -1);
+    }
+  });
+
+  bench(config, "nn train (sparse input)", n, [&]() {
+    for (auto const& s : corpus) {
+      nn->train(*gradient, nn_sparse_input_from_position(s.p_), expected, -1);
+    }
+  });
+
+  // Mini-batch training (train_batch), n_ops = batch size.
+  auto const bench_batch = [&]<size_t BatchSize>(
+                               std::integral_constant<size_t, BatchSize>) {
+    auto const dense_in =
+        std::make_unique<std::array<nn_t::input_t, BatchSize>>();
+    auto const sparse_in =
+        std::make_unique<std::array<nn_sparse_input_t, BatchSize>>();
+    auto const batch_expected =
+        std::make_unique<std::array<nn_t::output_t, BatchSize>>();
+    for (auto i = 0U; i != BatchSize; ++i) {
+      auto const& p = corpus[i % corpus.size()].p_;
+      (*dense_in)[i] = nn_input_from_position(p);
+      (*sparse_in)[i] = nn_sparse_input_from_position(p);
+      (*batch_expected)[i] = expected;
+    }
+    auto b = nn_t::batch{};
+    auto const suffix = " " + std::to_string(BatchSize) + ")";
+    bench(config, ("nn train batch (dense" + suffix).c_str(), BatchSize,
+          [&]() {
+            nn->train_batch(*gradient, *dense_in, *batch_expected, -1, b);
+          });
+    bench(config, ("nn train batch (sparse" + suffix).c_str(), BatchSize,
+          [&]() {
+            nn->train_batch(*gradient, *sparse_in, *batch_expected, -1, b);
+          });
+  };
+  bench_batch(std::integral_constant<size_t, 32U>{});
+  bench_batch(std::integral_constant<size_t, 128U>{});
+  bench_batch(std::integral_constant<size_t, 512U>{});
+  bench_batch(std::integral_constant<size_t, 1024U>{});
+
+  bench(config, "network::estimate (sparse)", n, [&]() {
+    for (auto const& s : corpus) {
+      sink += static_cast<size_t>(
+          nn->estimate(nn_sparse_input_from_position(s.p_))[0]);
+    }
+  });
+
+  auto const quantized = std::make_unique<quantized_network<nn_t>>(*nn);
+  for (auto const backend :
+       {simd_backend::SCALAR, simd_backend::SSSE3, simd_backend::AVX2}) {
+    if (backend > default_simd_backend()) {
+      continue;
+    }
+    active_simd_backend = backend;
+    auto const name = std::string{"nn estimate (int, "} + to_str(backend) + ")";
+    bench(config, name.c_str(), children.size(), [&]() {
+      for (auto const& p : children) {
+        sink += static_cast<size_t>(
+            quantized->estimate(nn_sparse_input_from_position(p))[0]);
+      }
+    });
+  }
+  active_simd_backend = default_simd_backend();
+
+  return sink == 42U ? 1 : 0;
+}
@@ -4,6 +4,7 @@
 
 #include "chessbot/pgn.h"
 #include "chessbot/position.h"
+#include "chessbot/quiescence.h"
 #include "chessbot/stockfish_evals.h"
 #include "chessbot/util.h"
 
@@ -20,6 +21,7 @@ int main(int argc, char** argv) {
   auto const fen_count = std::numeric_limits<int>::max();
   auto const threshold = -15;
   auto const min_time = 3.0;
+  auto const quiet_margin = 50;
 
   auto m = cista::mmap{path, cista::mmap::protection::READ};
   auto pgn = utl::cstr{m.data(), m.size()};
@@ -48,12 +50,18 @@ int main(int argc, char** argv) {
         p.make_pgn_move(g.moves_[i], nullptr);
       }
 
+      // Labels of positions with pending captures are noisy.
+      if (!is_quiet(p, quiet_margin)) {
+        continue;
+      }
+
       auto const evals = stockfish_evals(p);
       auto max = std::max_element(begin(evals), end(evals));
       if (max->second.mate_ < 0 || max->second.cp_ < threshold) {
         continue;
       }
-      std::cout << p.to_fen() << " ";
+      char fen[position::max_fen_length];
+      std::cout.write(fen, p.to_fen(fen) - fen) << " ";
       for (auto const& [m, e] : evals) {
         std::cout << m << " " << (e.mate_ != 0 ? "M" : "")
                   << (e.mate_ != 0 ? e.mate_ : e.cp_) << " ";
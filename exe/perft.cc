@@ -3,21 +3,48 @@
 #include <sstream>
 #include <vector>
 
+#include "chessbot/cpu_features.h"
 #include "chessbot/dfs.h"
+#include "chessbot/magic.h"
+#include "chessbot/parallel_dfs.h"
 #include "chessbot/position.h"
 #include "chessbot/timing.h"
 
 using namespace chessbot;
 
 int main(int argc, char** argv) {
-  if (argc < 3) {
-    std::cout << "usage: " << argv[0] << " DEPTH FEN [MOVE, ...]\n";
+  auto n_threads = 1U;
+  auto hash_mb = 0U;
+  auto args = std::vector<std::string_view>{};
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--threads" && i + 1 < argc) {
+      n_threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hash_mb = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--slider" && i + 1 < argc) {
+      auto const backend = std::string_view{argv[++i]};
+      if (backend == "pext" && !cpu_has_bmi2()) {
+        std::cout << "pext not supported by this cpu\n";
+        return 1;
+      }
+      set_slider_backend(backend == "pext" ? slider_backend::PEXT
+                                           : slider_backend::MAGIC);
+    } else {
+      args.emplace_back(arg);
+    }
+  }
+
+  if (args.size() < 2) {
+    std::cout << "usage: " << argv[0]
+              << " [--threads N] [--hash MB] [--slider magic|pext] DEPTH FEN "
+                 "[MOVE, ...]\n";
     return 1;
   }
 
-  auto const depth = std::stoi(argv[1]);
-  auto const fen =
-      std::string_view{argv[2]} == "startpos" ? start_position_fen : argv[2];
+  auto const depth = std::stoi(std::string{args[0]});
+  auto const fen = args[1] == "startpos" ? std::string{start_position_fen}
+                                         : std::string{args[1]};
 
   auto in = std::stringstream{fen};
   auto p = chessbot::position{};
@@ -30,8 +57,8 @@ int main(int argc, char** argv) {
   };
 
   std::stringstream moves;
-  for (auto i = 3; i < argc; ++i) {
-    moves << argv[3];
+  for (auto i = 2U; i < args.size(); ++i) {
+    moves << args[i] << ' ';
   }
 
   std::string move_str;
@@ -40,9 +67,28 @@ int main(int argc, char** argv) {
         p.make_move(move{p, move_str}, prev_state_info())));
   }
 
+  auto table =
+      hash_mb == 0U ? nullptr : std::make_unique<perft_table>(hash_mb);
+
   CHESSBOT_START_TIMING(dfs_rec);
-  auto const result = dfs_rec<true>(p, 0U, depth, prev_state_info());
+  auto result = size_t{0U};
+  if (n_threads == 1U) {
+    result = dfs_rec<true>(p, 0U, depth, prev_state_info(), table.get());
+  } else {
+    auto divide = divide_t{};
+    result = parallel_dfs(p, depth, prev_state_info(), n_threads, divide,
+                          table.get());
+    for (auto const& [m, leaves] : divide) {
+      printf("%s %zu\n", m.to_str().c_str(), leaves);
+    }
+  }
   CHESSBOT_STOP_TIMING(dfs_rec);
   std::cout << "\n" << result << "\n";
   std::cout << CHESSBOT_TIMING_MS(dfs_rec) << "ms\n";
+  std::cout << (active_slider_backend == slider_backend::PEXT ? "pext"
+                                                              : "magic")
+            << " " << static_cast<size_t>(
+                          result / std::max(1E-6, CHESSBOT_TIMING_US(dfs_rec) /
+                                                      1E6))
+            << " nps\n";
 }
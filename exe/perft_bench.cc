@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utl/verify.h"
+
+#include "chessbot/cpu_features.h"
+#include "chessbot/dfs.h"
+#include "chessbot/magic.h"
+#include "chessbot/parallel_dfs.h"
+#include "chessbot/perft_table.h"
+#include "chessbot/position.h"
+#include "chessbot/timing.h"
+
+using namespace chessbot;
+
+struct perft_position {
+  std::string name_, fen_;
+  std::vector<size_t> expected_;  // expected_[d - 1] = perft(d)
+};
+
+struct perft_result {
+  perft_position const& pos_;
+  unsigned depth_;
+  size_t nodes_;
+  long long time_us_;
+  bool ok() const { return nodes_ == pos_.expected_[depth_ - 1U]; }
+  double nps() const { return nodes_ / (std::max(time_us_, 1LL) / 1E6); }
+};
+
+// https://www.chessprogramming.org/Perft_Results
+std::vector<perft_position> classic_suite() {
+  return {
+      {"startpos",
+       std::string{start_position_fen},
+       {20U, 400U, 8902U, 197281U, 4865609U, 119060324U}},
+      {"kiwipete",
+       "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+       {48U, 2039U, 97862U, 4085603U, 193690690U}},
+      {"position3",
+       "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+       {14U, 191U, 2812U, 43238U, 674624U, 11030083U}},
+      {"position4",
+       "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+       {6U, 264U, 9467U, 422333U, 15833292U}},
+      {"position5",
+       "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+       {44U, 1486U, 62379U, 2103487U, 89941194U}},
+      {"position6",
+       "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - "
+       "0 10",
+       {46U, 2079U, 89890U, 3894594U, 164075551U}}};
+}
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1U);
+  }
+  while (!s.empty() &&
+         (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+    s.remove_suffix(1U);
+  }
+  return s;
+}
+
+// EPD perft format: "<fen> ;D1 <nodes> ;D2 <nodes> ..."
+std::vector<perft_position> read_epd(char const* path) {
+  auto in = std::ifstream{path};
+  utl::verify(in.good(), "could not open {}", path);
+
+  auto positions = std::vector<perft_position>{};
+  auto line = std::string{};
+  while (std::getline(in, line)) {
+    auto rest = std::string_view{line};
+    auto const fen_end = rest.find(';');
+    auto const fen = trim(rest.substr(0U, fen_end));
+    if (fen.empty() || fen.front() == '#') {
+      continue;
+    }
+
+    auto pos = perft_position{"epd:" + std::to_string(positions.size() + 1U),
+                              std::string{fen},
+                              {}};
+    while (fen_end != std::string_view::npos && !rest.empty()) {
+      auto const next = rest.find(';');
+      if (next == std::string_view::npos) {
+        break;
+      }
+      rest.remove_prefix(next + 1U);
+      auto const field = trim(rest.substr(0U, rest.find(';')));
+      if (field.size() > 1U && field[0] == 'D') {
+        auto const space = field.find(' ');
+        auto const depth = std::stoul(std::string{field.substr(1U, space)});
+        utl::verify(depth == pos.expected_.size() + 1U,
+                    "{}: depths must be consecutive starting at D1", path);
+        pos.expected_.emplace_back(
+            std::stoull(std::string{trim(field.substr(space))}));
+      }
+    }
+    utl::verify(!pos.expected_.empty(), "{}: no node counts for {}", path,
+                pos.fen_);
+    positions.emplace_back(std::move(pos));
+  }
+  return positions;
+}
+
+void print_json(std::vector<perft_result> const& results,
+                size_t const total_nodes, long long const total_us,
+                bool const all_ok) {
+  printf("{\n  \"slider_backend\": \"%s\",\n  \"positions\": [\n",
+         active_slider_backend == slider_backend::PEXT ? "pext" : "magic");
+  for (auto i = 0U; i != results.size(); ++i) {
+    auto const& r = results[i];
+    printf(
+        "    {\"name\": \"%s\", \"fen\": \"%s\", \"depth\": %u, "
+        "\"nodes\": %zu, \"expected\": %zu, \"ok\": %s, \"time_us\": %lld, "
+        "\"nps\": %.0f}%s\n",
+        r.pos_.name_.c_str(), r.pos_.fen_.c_str(), r.depth_, r.nodes_,
+        r.pos_.expected_[r.depth_ - 1U], r.ok() ? "true" : "false",
+        r.time_us_, r.nps(), i + 1U == results.size() ? "" : ",");
+  }
+  printf(
+      "  ],\n  \"total\": {\"nodes\": %zu, \"time_us\": %lld, \"nps\": %.0f, "
+      "\"ok\": %s}\n}\n",
+      total_nodes, total_us, total_nodes / (std::max(total_us, 1LL) / 1E6),
+      all_ok ? "true" : "false");
+}
+
+int main(int argc, char** argv) {
+  auto max_depth = 5U;
+  auto n_threads = 1U;
+  auto hash_mb = 0U;
+  auto json = false;
+  auto use_suite = true;
+  auto positions = std::vector<perft_position>{};
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--depth" && i + 1 < argc) {
+      max_depth = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      n_threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hash_mb = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--epd" && i + 1 < argc) {
+      auto const epd = read_epd(argv[++i]);
+      positions.insert(end(positions), begin(epd), end(epd));
+    } else if (arg == "--no-suite") {
+      use_suite = false;
+    } else if (arg == "--slider" && i + 1 < argc) {
+      auto const backend = std::string_view{argv[++i]};
+      if (backend == "pext" && !cpu_has_bmi2()) {
+        std::cout << "pext not supported by this cpu\n";
+        return 1;
+      }
+      set_slider_backend(backend == "pext" ? slider_backend::PEXT
+                                           : slider_backend::MAGIC);
+    } else if (arg == "--json") {
+      json = true;
+    } else {
+      std::cout << "usage: " << argv[0]
+                << " [--depth N] [--threads N] [--hash MB] [--epd FILE] "
+                   "[--no-suite] [--slider magic|pext] [--json]\n";
+      return 1;
+    }
+  }
+  if (use_suite) {
+    auto const suite = classic_suite();
+    positions.insert(begin(positions), begin(suite), end(suite));
+  }
+
+  auto results = std::vector<perft_result>{};
+  auto total_nodes = size_t{0U};
+  auto total_us = 0LL;
+  auto all_ok = true;
+  for (auto const& pos : positions) {
+    auto const depth =
+        std::min(max_depth, static_cast<unsigned>(pos.expected_.size()));
+    auto p = position::from_fen(pos.fen_);
+    auto table =
+        hash_mb == 0U ? nullptr : std::make_unique<perft_table>(hash_mb);
+
+    CHESSBOT_START_TIMING(perft);
+    auto nodes = size_t{0U};
+    if (n_threads == 1U) {
+      nodes = dfs_rec(p, 0U, depth, nullptr, table.get());
+    } else {
+      auto divide = divide_t{};
+      nodes = parallel_dfs(p, depth, nullptr, n_threads, divide, table.get());
+    }
+    CHESSBOT_STOP_TIMING(perft);
+
+    auto const& r = results.emplace_back(
+        perft_result{pos, depth, nodes, CHESSBOT_TIMING_US(perft)});
+    total_nodes += r.nodes_;
+    total_us += r.time_us_;
+    all_ok = all_ok && r.ok();
+
+    if (!json) {
+      printf("%-12s depth %u  %12zu nodes  %8.1f ms  %12.0f nps  %s\n",
+             pos.name_.c_str(), depth, nodes, r.time_us_ / 1E3, r.nps(),
+             r.ok() ? "ok" : "MISMATCH");
+      if (!r.ok()) {
+        printf("  expected %zu for %s\n", pos.expected_[depth - 1U],
+               pos.fen_.c_str());
+      }
+    }
+  }
+
+  if (json) {
+    print_json(results, total_nodes, total_us, all_ok);
+  } else {
+    printf("%-12s          %12zu nodes  %8.1f ms  %12.0f nps  %s\n", "total",
+           total_nodes, total_us / 1E3,
+           total_nodes / (std::max(total_us, 1LL) / 1E6),
+           all_ok ? "ok" : "MISMATCH");
+  }
+
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chessbot/position.h"
+#include "chessbot/search.h"
+
+using namespace chessbot;
+
+std::string score_to_str(score_t const score) {
+  if (!is_mate_score(score)) {
+    return "cp " + std::to_string(score);
+  }
+  auto const plies = mate_score - std::abs(score);
+  return "mate " + std::to_string(score > 0 ? (plies + 1) / 2 : -plies / 2);
+}
+
+// Fixed positions for comparing nodes and time to depth between versions.
+constexpr char const* const bench_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "r1b2rk1/2q1bppp/p2p1n2/np2p3/3PP3/5N1P/PPBN1PP1/R1BQR1K1 w - - 1 13",
+    "8/5pk1/6p1/8/3R4/6P1/5PK1/2r5 w - - 0 40",
+    "8/pp3k2/2p2p2/3p4/3P1P2/2P3K1/PP6/8 w - - 0 30",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+};
+
+int run_bench(search_limits const& limits, unsigned const hash_mb,
+              unsigned const n_threads, search_options const& options) {
+  auto total_nodes = size_t{0U};
+  auto total_us = 0LL;
+  for (auto const fen : bench_fens) {
+    auto tt = hash_mb == 0U ? nullptr
+                            : std::make_unique<transposition_table>(hash_mb);
+    auto const r = search(position::from_fen(fen), nullptr, limits, {},
+                          tt.get(), n_threads, options);
+    std::cout << r.nodes_ << " nodes " << r.time_us_ / 1000 << "ms bestmove "
+              << r.best_move_ << " " << score_to_str(r.score_) << " " << fen
+              << "\n";
+    total_nodes += r.nodes_;
+    total_us += r.time_us_;
+  }
+  std::cout << "total: " << total_nodes << " nodes, " << total_us / 1000
+            << "ms, " << static_cast<size_t>(total_nodes / (total_us / 1E6))
+            << " nps\n";
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  auto limits = search_limits{};
+  auto n_threads = 1U;
+  auto hash_mb = 16U;
+  auto bench = false;
+  auto options = search_options{};
+  auto args = std::vector<std::string_view>{};
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--depth" && i + 1 < argc) {
+      limits.max_depth_ = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--nodes" && i + 1 < argc) {
+      limits.max_nodes_ = std::stoull(argv[++i]);
+    } else if (arg == "--time" && i + 1 < argc) {
+      limits.max_time_ = std::chrono::milliseconds{std::stoul(argv[++i])};
+    } else if (arg == "--threads" && i + 1 < argc) {
+      n_threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hash_mb = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--bench") {
+      bench = true;
+    } else if (arg == "--no-null-move") {
+      options.null_move_ = false;
+    } else if (arg == "--no-lmr") {
+      options.lmr_ = false;
+    } else if (arg == "--no-futility") {
+      options.futility_ = false;
+    } else if (arg == "--no-razoring") {
+      options.razoring_ = false;
+    } else {
+      args.emplace_back(arg);
+    }
+  }
+
+  if (args.empty() && !bench) {
+    std::cout << "usage: " << argv[0]
+              << " [--depth N] [--nodes N] [--time MS] [--threads N] "
+                 "[--hash MB] [--no-null-move] [--no-lmr] [--no-futility] "
+                 "[--no-razoring] (--bench | FEN [MOVE, ...])\n";
+    return 1;
+  }
+  if (limits.max_depth_ == 0U && limits.max_nodes_ == 0U &&
+      limits.max_time_.count() == 0) {
+    limits.max_depth_ = 6U;
+  }
+  if (bench) {
+    return run_bench(limits, hash_mb, n_threads, options);
+  }
+
+  auto p = args[0] == "startpos" ? position::from_fen(start_position_fen)
+                                 : position::from_fen(std::string{args[0]});
+
+  std::vector<std::unique_ptr<state_info>> initial_move_states;
+  auto const prev_state_info = [&]() -> state_info const* {
+    return initial_move_states.empty() ? nullptr
+                                       : initial_move_states.back().get();
+  };
+  for (auto i = 1U; i < args.size(); ++i) {
+    initial_move_states.emplace_back(std::make_unique<state_info>(
+        p.make_move(move{p, std::string{args[i]}}, prev_state_info())));
+  }
+
+  auto tt = hash_mb == 0U ? nullptr
+                          : std::make_unique<transposition_table>(hash_mb);
+  auto const result = search(
+      p, prev_state_info(), limits,
+      [&](search_result const& r) {
+        std::cout << "info depth " << r.depth_ << " score "
+                  << score_to_str(r.score_) << " nodes " << r.nodes_
+                  << " nps " << static_cast<size_t>(r.nps()) << " time "
+                  << r.time_us_ / 1000;
+        if (tt != nullptr) {
+          std::cout << " hashfull " << tt->hashfull();
+        }
+        std::cout << " pv";
+        for (auto const m : r.pv_) {
+          std::cout << " " << m;
+        }
+        std::cout << std::endl;
+      },
+      tt.get(), n_threads, options);
+
+  std::cout << "bestmove " << result.best_move_ << "\n";
+  std::cout << result.nodes_ << " nodes, " << result.time_us_ / 1000
+            << "ms, " << static_cast<size_t>(result.nps()) << " nps\n";
+}
@@ -1,13 +1,19 @@
 #include <cista/mmap.h>
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "utl/enumerate.h"
 
 #include "chessbot/nn.h"
 #include "chessbot/nn_chess.h"
+#include "chessbot/nn_quantized.h"
 #include "chessbot/plot.h"
 #include "chessbot/read_training_set.h"
+#include "chessbot/timing.h"
 
 using namespace chessbot;
 
@@ -16,13 +22,24 @@ constexpr auto const inner_loop_size = 100000;
 constexpr auto const learning_rate = 0.53;
 
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " [TRAINING_FILE]\n";
+  auto n_threads = 1U;
+  auto args = std::vector<std::string_view>{};
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--threads" && i + 1 < argc) {
+      n_threads = std::max(1, std::stoi(argv[++i]));
+    } else {
+      args.emplace_back(arg);
+    }
+  }
+
+  if (args.empty()) {
+    std::cout << "usage: " << argv[0] << " [--threads N] TRAINING_FILE\n";
     return 1;
   }
 
-  std::cout << "reading training set " << argv[1] << " ...\n";
-  std::ifstream in{argv[1]};
+  std::cout << "reading training set " << args[0] << " ...\n";
+  std::ifstream in{std::string{args[0]}};
   auto const training_set = read_training_set(in);
 
   auto counts = std::map<std::string, unsigned>{};
@@ -42,32 +59,40 @@ int main(int argc, char** argv) {
   }
 
   std::cout << "building training data ...\n";
-  auto input = std::array<std::array<real_t, input_size>, batch_size>{};
+  auto input = std::array<nn_sparse_input_t, batch_size>{};
   auto expected = std::array<std::array<real_t, output_size>, batch_size>{};
 
   for (auto i = 0; i < batch_size; ++i) {
     auto const& [p, moves] = training_set[i];
-    input[i] = nn_input_from_position(p);
+    input[i] = nn_sparse_input_from_position(p);
     expected[i] = to_expected(moves);
   }
 
   auto pl_absolute_errors = plot{""};
   auto pl_max_errors = plot{""};
 
-  auto n = std::make_unique<network<input_size, 16, 16, output_size>>();
+  using nn_t = network<input_size, 16, 16, output_size>;
+  auto n = std::make_unique<nn_t>();
 
-  std::cout << "training network ...\n";
+  std::cout << "training network (" << n_threads << " threads) ...\n";
+  CHESSBOT_START_TIMING(train);
   n->train_epoch(
-      input, expected, learning_rate, inner_loop_size, [&](unsigned i) {
+      input, expected, learning_rate, inner_loop_size,
+      [&](unsigned i) {
         if (i != 0 && i % std::max(1, inner_loop_size / 100) == 0) {
           const auto [e1, e2] = determine_error(*n, input, expected);
           pl_absolute_errors.add_entry(i, e1);
           pl_max_errors.add_entry(i, e2);
           std::cout << "\r" << i << " / " << inner_loop_size << std::flush;
         }
-      });
+      },
+      n_threads);
 
-  std::cout << "\n";
+  CHESSBOT_STOP_TIMING(train);
+  std::cout << "\n"
+            << (batch_size * inner_loop_size) /
+                   (std::max<long long>(CHESSBOT_TIMING_MS(train), 1) / 1000.0)
+            << " samples/s (including error plots)\n";
 
   std::cout << "writing trained weights ...\n";
   {
@@ -76,6 +101,18 @@ int main(int argc, char** argv) {
     std::memcpy(out.data(), &*n, sizeof(*n));
   }
 
+  std::cout << "quantizing network ...\n";
+  {
+    auto const q = std::make_unique<quantized_network<nn_t>>(*n);
+    auto const [e1, e2] = determine_error(*n, input, expected);
+    auto const [q1, q2] = determine_error(*q, input, expected);
+    auto const [mean_diff, max_diff] = output_difference(*n, *q, input);
+    std::cout << "float:     squared error " << e1 << ", max error " << e2
+              << "\nquantized: squared error " << q1 << ", max error " << q2
+              << "\ndifference: mean " << mean_diff << ", max " << max_diff
+              << "\n";
+  }
+
   std::cout << "building statistics ...\n";
   auto test_fens = std::array<std::string, batch_size>{};
   for (auto const& [i, entry] : utl::enumerate(training_set)) {
@@ -19,6 +19,7 @@ enum class result { ONGOING, WHITE_WIN, BLACK_WIN, REMIS };
 enum color : bool { WHITE, BLACK };
 
 constexpr auto const max_moves = 256;
+constexpr auto const max_search_ply = 128U;
 
 template <color Color>
 constexpr color opposing_color() {
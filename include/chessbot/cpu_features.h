@@ -0,0 +1,52 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace chessbot {
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+inline bool cpuid_bit(int const leaf, int const reg, int const bit) {
+  int regs[4];
+  __cpuidex(regs, leaf, 0);
+  return (regs[reg] >> bit) & 1;
+}
+#endif
+
+// Runtime checks, so binaries built without -m flags can still dispatch to
+// instruction set specific code paths.
+inline bool cpu_has_bmi2() {
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+  return __builtin_cpu_supports("bmi2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return cpuid_bit(7, 1, 8);  // EBX bit 8
+#else
+  return false;
+#endif
+}
+
+inline bool cpu_has_ssse3() {
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+  return __builtin_cpu_supports("ssse3");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return cpuid_bit(1, 2, 9);  // ECX bit 9
+#else
+  return false;
+#endif
+}
+
+inline bool cpu_has_avx2() {
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return cpuid_bit(7, 1, 5);  // EBX bit 5
+#else
+  return false;
+#endif
+}
+
+}  // namespace chessbot
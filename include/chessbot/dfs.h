@@ -1,19 +1,34 @@
 #pragma once
 
 #include "chessbot/generate_moves.h"
+#include "chessbot/history.h"
+#include "chessbot/perft_table.h"
 #include "chessbot/position.h"
 
 namespace chessbot {
 
 template <bool IsRoot = false>
-size_t dfs_rec(position& p, unsigned const current_depth,
-               unsigned const max_depth, state_info const* const info_ptr) {
-  if (p.half_move_clock_ == 100 || count_repetitions(p, info_ptr) >= 3U) {
+size_t dfs_rec(position& p, history& h, unsigned const current_depth,
+               unsigned const max_depth, perft_table* const table = nullptr) {
+  if (p.half_move_clock_ == 100 || h.count_repetitions(p) >= 3U) {
     return 1U;
   }
 
-  auto const copy = p;
+  if constexpr (!IsRoot) {
+    if (current_depth + 1 == max_depth) {
+      return count_moves(p);
+    }
+  }
+
+  // A threefold repetition below this node needs a half move clock >= 12.
+  // If that can't be reached, the leaf count only depends on the position.
+  auto const remaining_depth = max_depth - current_depth;
+  auto const use_table = !IsRoot && table != nullptr && remaining_depth > 1U &&
+                         p.half_move_clock_ + remaining_depth <= 12U;
   auto leaf_nodes = size_t{0U};
+  if (use_table && table->get(p.hash_, remaining_depth, leaf_nodes)) {
+    return leaf_nodes;
+  }
 
   std::array<move, max_moves> move_list;
   auto const begin = &move_list[0];
@@ -27,17 +42,29 @@ size_t dfs_rec(position& p, unsigned const current_depth,
     leaf_nodes += (end - begin);
   } else {
     for (auto it = begin; it != end; ++it) {
-      auto const s = p.make_move(*it, info_ptr);
-      auto const leaves = dfs_rec(p, current_depth + 1, max_depth, &s);
+      h.push(p, *it);
+      auto const leaves = dfs_rec(p, h, current_depth + 1, max_depth, table);
       if constexpr (IsRoot) {
         printf("%s %zu\n", it->to_str().c_str(), leaves);
       }
       leaf_nodes += leaves;
-      p = copy;
+      h.pop(p);
     }
   }
 
+  if (use_table) {
+    table->set(p.hash_, remaining_depth, leaf_nodes);
+  }
+
   return leaf_nodes;
 }
 
+template <bool IsRoot = false>
+size_t dfs_rec(position& p, unsigned const current_depth,
+               unsigned const max_depth, state_info const* const info_ptr,
+               perft_table* const table = nullptr) {
+  auto h = history{p, info_ptr, max_depth - current_depth};
+  return dfs_rec<IsRoot>(p, h, current_depth, max_depth, table);
+}
+
 }  // namespace chessbot
\ No newline at end of file
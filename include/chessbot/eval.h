@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "chessbot/constants.h"
+#include "chessbot/position.h"
+#include "chessbot/psqt.h"
+
+namespace chessbot {
+
+using score_t = int;
+
+constexpr auto const piece_values =
+    std::array<score_t, NUM_PIECE_TYPES>{100, 320, 330, 500, 900, 0};
+
+// Material and piece-square score recomputed from scratch.
+psq_score compute_psq(position const&);
+
+// Interpolates between the middlegame and endgame psq scores by game
+// phase. Side to move relative, O(1) from the incremental position::psq_.
+inline score_t tapered_eval(position const& p) {
+  auto const phase = std::min(p.psq_.phase_, max_phase);
+  auto const score =
+      (p.psq_.mg_ * phase + p.psq_.eg_ * (max_phase - phase)) / max_phase;
+  return p.to_move_ == color::WHITE ? score : -score;
+}
+
+// Evaluation used by search and quiescence.
+inline score_t static_eval(position const& p) { return tapered_eval(p); }
+
+}  // namespace chessbot
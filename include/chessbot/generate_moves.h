@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <cstdio>
 
@@ -12,17 +14,20 @@
 
 namespace chessbot {
 
+// Walks the state_info chain. Hot paths use history::count_repetitions.
+// Only every other ply can have the same side to move.
 inline unsigned count_repetitions(position const& p,
                                   state_info const* const info) {
   auto repetitions = 0U;
-  auto half_moves = p.half_move_clock_;
-  auto curr_state = info;
-  while (curr_state != nullptr && half_moves != 0U) {
+  auto half_moves = unsigned{p.half_move_clock_};
+  auto curr_state = info == nullptr ? nullptr : info->prev_state_info_;
+  while (curr_state != nullptr && half_moves >= 2U) {
     if (curr_state->prev_hash_ == p.hash_) {
       ++repetitions;
     }
     curr_state = curr_state->prev_state_info_;
-    --half_moves;
+    curr_state = curr_state == nullptr ? nullptr : curr_state->prev_state_info_;
+    half_moves -= 2U;
   }
   return repetitions;
 }
@@ -64,330 +69,488 @@ inline bool blocker_can_move(position const& p, unsigned king_square_idx,
   }
 }
 
+// Squares attacked by the pieces of color C for the given occupancy.
+template <color C>
+bitboard attacked_squares(position const& p, bitboard const occupancy) {
+  auto const queens = p.pieces<C, piece_type::QUEEN>();
+  auto attacked = pawn_attacks_bb(p.pieces<C, piece_type::PAWN>(), C);
+  attacked |= king_attacks_by_origin_square[cista::trailing_zeros(
+      p.pieces<C, piece_type::KING>())];
+  for_each_set_bit(p.pieces<C, piece_type::KNIGHT>(), [&](bitboard const n) {
+    attacked |= knight_attacks_by_origin_square[cista::trailing_zeros(n)];
+  });
+  for_each_set_bit(p.pieces<C, piece_type::BISHOP>() | queens,
+                   [&](bitboard const b) {
+                     attacked |= get_attack_squares<BISHOP>(b, occupancy);
+                   });
+  for_each_set_bit(p.pieces<C, piece_type::ROOK>() | queens,
+                   [&](bitboard const r) {
+                     attacked |= get_attack_squares<ROOK>(r, occupancy);
+                   });
+  return attacked;
+}
+
+// Target squares for non-king moves: everything if not in check,
+// checker + squares in between if in check by one piece, nothing otherwise.
 template <color ToMove>
-move* generate_moves(position const& p, move* move_list) {
-  auto const our_king = p.pieces<ToMove, piece_type::KING>();
-  auto const opposing_pawns =
-      p.pieces<opposing_color<ToMove>(), piece_type::PAWN>();
-  const auto opposing_knights =
-      p.pieces<opposing_color<ToMove>(), piece_type::KNIGHT>();
-  const auto opposing_king =
-      p.pieces<opposing_color<ToMove>(), piece_type::KING>();
-  auto const opposing_queen =
-      p.pieces<opposing_color<ToMove>(), piece_type::QUEEN>();
-  auto const opposing_streight_movers =
-      p.pieces<opposing_color<ToMove>(), piece_type::ROOK>() | opposing_queen;
-  auto const opposing_diagonal_movers =
-      p.pieces<opposing_color<ToMove>(), piece_type::BISHOP>() | opposing_queen;
-  auto const king_square_idx = cista::trailing_zeros(p.pieces<ToMove, KING>());
-
-  auto const compute_pawn_attacks = [&](bitboard const to) {
-    auto opposing_pawns_without_captured = opposing_pawns & ~to;
-    if (to & p.en_passant_) {
-      opposing_pawns_without_captured &=
-          ~(ToMove == color::WHITE ? to << 8 : to >> 8);
-    }
-    auto attacked_bb = bitboard{};
-    if (ToMove == color::WHITE) {
-      attacked_bb |= (opposing_pawns_without_captured & ~full_file_bitboard(FA))
-                     << 7;
-      attacked_bb |= (opposing_pawns_without_captured & ~full_file_bitboard(FH))
-                     << 9;
-    } else {
-      attacked_bb |=
-          (opposing_pawns_without_captured & ~full_file_bitboard(FA)) >> 9;
-      attacked_bb |=
-          (opposing_pawns_without_captured & ~full_file_bitboard(FH)) >> 7;
+bitboard check_mask(position const& p, unsigned const king_square_idx) {
+  auto const checkers = p.checkers_[ToMove];
+  if (checkers == 0U) {
+    return full_bitboard;
+  } else if (std::popcount(checkers) > 1) {
+    return 0U;
+  }
+  auto const checker_idx = cista::trailing_zeros(checkers);
+  return checkers | rook_line_bb[king_square_idx][checker_idx] |
+         bishop_line_bb[king_square_idx][checker_idx];
+}
+
+// Own pieces that are the only piece between the king and a pinner.
+template <color ToMove>
+bitboard pinned_pieces(position const& p, unsigned const king_square_idx) {
+  auto pinned = bitboard{0U};
+  auto const all_pieces = p.all_pieces();
+  for_each_set_bit(p.pinners_[ToMove], [&](bitboard const pinner) {
+    auto const pinner_idx = cista::trailing_zeros(pinner);
+    auto const between = (rook_line_bb[king_square_idx][pinner_idx] |
+                          bishop_line_bb[king_square_idx][pinner_idx]) &
+                         all_pieces;
+    if (std::has_single_bit(between)) {
+      pinned |= between & p.pieces_by_color_[ToMove];
     }
-    return attacked_bb;
-  };
-  auto const pawn_attacks_without_capture = compute_pawn_attacks(0U);
-  auto const get_pawn_attacks = [&](bitboard const to) {
-    return to & (opposing_pawns | p.en_passant_) ? compute_pawn_attacks(to)
-                                                 : pawn_attacks_without_capture;
-  };
+  });
+  return pinned;
+}
 
-  // OLD CODE
-  auto const valid_move_old = [&](bitboard const from, bitboard const to) {
-    auto const king_bb = p.pieces<ToMove, piece_type::KING>();
-    auto const king = (from & king_bb) ? to : king_bb;
+// Squares a pinned piece may move to: the ray from the king through it.
+inline bitboard pin_mask(unsigned const king_square_idx,
+                         bitboard const pinned_piece) {
+  auto const idx = cista::trailing_zeros(pinned_piece);
+  return rook_line_to_edge_bb[king_square_idx][idx] |
+         bishop_line_to_edge_bb[king_square_idx][idx];
+}
 
-    auto const king_square_idx = cista::trailing_zeros(king);
-    if ((opposing_knights & ~to &
-         knight_attacks_by_origin_square[king_square_idx]) ||
-        (opposing_king & king_attacks_by_origin_square[king_square_idx]) ||
-        (get_pawn_attacks(to) & king)) {
+template <color ToMove>
+bool is_short_castle_legal(position const& p) {
+  if (!p.can_short_castle<ToMove>()) {
+    return false;
+  }
+
+  auto const all_pieces = p.all_pieces();
+  auto const opposing_queen =
+      p.pieces<opposing_color<ToMove>(), piece_type::QUEEN>();
+  if ((short_castle_rook_traversal_squares[ToMove] & all_pieces) ||
+      (short_castle_knight_attack_squares[ToMove] &
+       p.pieces<opposing_color<ToMove>(), piece_type::KNIGHT>()) ||
+      (short_castle_pawn_king_attack_squares[ToMove] &
+       (p.pieces<opposing_color<ToMove>(), piece_type::KING>() |
+        p.pieces<opposing_color<ToMove>(), piece_type::PAWN>()))) {
+    return false;
+  }
+
+  for (auto const king_traversal_square :
+       short_castle_king_traversal_squares[ToMove]) {
+    if (get_attack_squares<ROOK>(king_traversal_square, all_pieces) &
+            (p.pieces<opposing_color<ToMove>(), piece_type::ROOK>() |
+             opposing_queen) ||
+        get_attack_squares<BISHOP>(king_traversal_square, all_pieces) &
+            (p.pieces<opposing_color<ToMove>(), piece_type::BISHOP>() |
+             opposing_queen)) {
       return false;
     }
+  }
 
-    auto occupancy_after_move_bb = (p.all_pieces() & ~from) | to;
-    if (p.en_passant_ == to && from & p.pieces<ToMove, piece_type::PAWN>()) {
-      occupancy_after_move_bb &=
-          ~north_west(to, ToMove == color::WHITE ? -1 : 1, 0);
-    }
+  return true;
+}
+
+template <color ToMove>
+bool is_long_castle_legal(position const& p) {
+  if (!p.can_long_castle<ToMove>()) {
+    return false;
+  }
+
+  auto const all_pieces = p.all_pieces();
+  auto const opposing_queen =
+      p.pieces<opposing_color<ToMove>(), piece_type::QUEEN>();
+  if ((long_castle_rook_traversal_squares[ToMove] & all_pieces) ||
+      (long_castle_knight_attack_squares[ToMove] &
+       p.pieces<opposing_color<ToMove>(), piece_type::KNIGHT>()) ||
+      (long_castle_pawn_king_attack_squares[ToMove] &
+       (p.pieces<opposing_color<ToMove>(), piece_type::KING>() |
+        p.pieces<opposing_color<ToMove>(), piece_type::PAWN>()))) {
+    return false;
+  }
 
-    if ((opposing_diagonal_movers != 0U &&
-         (get_attack_squares<BISHOP>(king, occupancy_after_move_bb) &
-          opposing_diagonal_movers & ~to)) ||
-        (opposing_streight_movers != 0U &&
-         (get_attack_squares<ROOK>(king, occupancy_after_move_bb) &
-          opposing_streight_movers & ~to))) {
+  for (auto const king_traversal_square :
+       long_castle_king_traversal_squares[ToMove]) {
+    if ((get_attack_squares<ROOK>(king_traversal_square, all_pieces) &
+         (p.pieces<opposing_color<ToMove>(), piece_type::ROOK>() |
+          opposing_queen)) ||
+        (get_attack_squares<BISHOP>(king_traversal_square, all_pieces) &
+         (p.pieces<opposing_color<ToMove>(), piece_type::BISHOP>() |
+          opposing_queen))) {
       return false;
     }
+  }
 
-    return true;
-  };
+  return true;
+}
 
-  // OLD CODE END
-  auto const is_valid_move = [&](bitboard const from, bitboard const to,
-                                 special_move const sm) -> bool {
-    if (!p.checkers_[ToMove]  // no check
-        && !(from & p.blockers_for_king_[ToMove])  // no blocker moved
-        && !(from & our_king)  // not a king move
-    ) {
-      return true;
-    } else if (from & our_king) {
-      return valid_move_old(from, to);
-    } else if (p.checkers_[ToMove]) {  // in check
-      if (std::popcount(p.checkers_[ToMove]) > 1) {  // multiple checkers
-        return false;
-      } else {  // in check from one piece
-        // blocker for king moves
-        if (from & p.blockers_for_king_[ToMove]) {
-          if (!blocker_can_move<ToMove>(p, king_square_idx, from, to, 0)) {
-            return false;
-          }
-        }
-        if (p.checkers_[ToMove] & to) {
-          return true;
-        }
-        if ((p.en_passant_ & to) && (p.piece_states_[PAWN] & from)) {
-          auto const capture_square_bb =
-              ToMove == color::WHITE ? p.en_passant_ << 8 : p.en_passant_ >> 8;
-          if (capture_square_bb & p.checkers_[ToMove]) {
-            return true;
-          }
-        }
-        if (p.checkers_[ToMove] &
-            (p.piece_states_[ROOK] | p.piece_states_[QUEEN] |
-             p.piece_states_[BISHOP])) {
-          const auto checker = cista::trailing_zeros(p.checkers_[ToMove]);
-          return (bishop_line_bb[king_square_idx][checker] |
-                  rook_line_bb[king_square_idx][checker]) &
-                 to;
-        }
-        return false;
-      }
-    } else if (from & p.blockers_for_king_[ToMove]) {
-      if ((p.en_passant_ & to) && (p.piece_states_[PAWN] & from)) {
-        auto const capture_square_bb =
-            ToMove == color::WHITE ? p.en_passant_ << 8 : p.en_passant_ >> 8;
-        if (!blocker_can_move<ToMove>(p, king_square_idx, capture_square_bb, to,
-                                      from)) {
-          return false;
-        }
+// En passant can uncover the king along the rank of the captured pawn,
+// so it is checked by recomputing slider attacks on the king.
+template <color ToMove>
+bool is_en_passant_legal(position const& p, bitboard const from) {
+  constexpr auto const them = opposing_color<ToMove>();
+  auto const captured =
+      ToMove == WHITE ? p.en_passant_ << 8 : p.en_passant_ >> 8;
+  auto const occupancy = p.all_pieces() ^ from ^ captured ^ p.en_passant_;
+  auto const king = p.pieces<ToMove, piece_type::KING>();
+  auto const opposing_queens = p.pieces<them, piece_type::QUEEN>();
+  return (p.checkers_[ToMove] & ~captured &
+          (p.pieces<them, piece_type::KNIGHT>() |
+           p.pieces<them, piece_type::PAWN>())) == 0U &&
+         (get_attack_squares<BISHOP>(king, occupancy) &
+          (p.pieces<them, piece_type::BISHOP>() | opposing_queens)) == 0U &&
+         (get_attack_squares<ROOK>(king, occupancy) &
+          (p.pieces<them, piece_type::ROOK>() | opposing_queens)) == 0U;
+}
+
+// Whether the (legal) move m puts the opposing king in check, directly or
+// by discovery.
+template <color ToMove>
+bool gives_check(position const& p, move const m) {
+  constexpr auto const them = opposing_color<ToMove>();
+  auto const opposing_king = p.pieces<them, piece_type::KING>();
+  auto from = m.from();
+  auto to = m.to();
+
+  auto rooks = p.pieces<ToMove, piece_type::ROOK>() |
+               p.pieces<ToMove, piece_type::QUEEN>();
+  auto bishops = p.pieces<ToMove, piece_type::BISHOP>() |
+                 p.pieces<ToMove, piece_type::QUEEN>();
+  auto occupancy = p.all_pieces();
+  if (m.special_move_ == special_move::CASTLE) {
+    // Only the rook can give check.
+    auto const first_rank = ToMove == color::WHITE ? R1 : R8;
+    auto const is_long = to == rank_file_to_bitboard(first_rank, FA);
+    auto const king_to = rank_file_to_bitboard(first_rank, is_long ? FC : FG);
+    auto const rook_to = rank_file_to_bitboard(first_rank, is_long ? FD : FF);
+    occupancy ^= from | to | king_to | rook_to;
+    return get_attack_squares<ROOK>(rook_to, occupancy) & opposing_king;
+  }
+
+  occupancy = (occupancy & ~from) | to;
+  if (m.special_move_ == special_move::NONE && (from & p.piece_states_[PAWN]) &&
+      (to & p.en_passant_)) {
+    occupancy ^= ToMove == WHITE ? to << 8 : to >> 8;
+  }
+
+  auto piece = piece_type::NUM_PIECE_TYPES;
+  if (m.special_move_ == special_move::PROMOTION) {
+    switch (m.promotion_piece_type_) {
+      case promotion_piece_type::KNIGHT: piece = KNIGHT; break;
+      case promotion_piece_type::BISHOP: piece = BISHOP; break;
+      case promotion_piece_type::ROOK: piece = ROOK; break;
+      case promotion_piece_type::QUEEN: piece = QUEEN; break;
+    }
+  } else {
+    for (auto const pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+      if (p.piece_states_[pt] & from) {
+        piece = pt;
+        break;
       }
-      return blocker_can_move<ToMove>(p, king_square_idx, from, to, 0);
     }
+  }
 
-    assert(false);
-    return true;
-  };
+  rooks &= ~from;
+  bishops &= ~from;
+  switch (piece) {
+    case PAWN:
+      if (pawn_attacks_bb(to, ToMove) & opposing_king) {
+        return true;
+      }
+      break;
+    case KNIGHT:
+      if (knight_attacks_by_origin_square[cista::trailing_zeros(to)] &
+          opposing_king) {
+        return true;
+      }
+      break;
+    case ROOK: rooks |= to; break;
+    case BISHOP: bishops |= to; break;
+    case QUEEN:
+      rooks |= to;
+      bishops |= to;
+      break;
+    default: break;
+  }
 
+  return (get_attack_squares<ROOK>(opposing_king, occupancy) & rooks) ||
+         (get_attack_squares<BISHOP>(opposing_king, occupancy) & bishops);
+}
+
+enum class gen_type : uint8_t {
+  CAPTURES,  // captures (including en passant) and all promotions
+  QUIETS,  // all other moves, including castling
+  EVASIONS,  // all moves if in check, none otherwise
+  QUIET_CHECKS,  // quiet moves that give check
+  ALL
+};
+
+// Legality is decided per node, not per move: king moves are restricted by
+// the opponent's attack map, all other moves by the check mask and, for
+// pinned pieces, by the ray from the king through the piece.
+template <color ToMove, gen_type GenType = gen_type::ALL>
+move* generate_moves(position const& p, move* move_list) {
+  constexpr auto const them = opposing_color<ToMove>();
+  constexpr auto const captures =
+      GenType == gen_type::CAPTURES || GenType == gen_type::EVASIONS ||
+      GenType == gen_type::ALL;
+  constexpr auto const quiets = GenType != gen_type::CAPTURES;
+
+  if constexpr (GenType == gen_type::EVASIONS) {
+    if (p.checkers_[ToMove] == 0U) {
+      return move_list;
+    }
+  }
+
+  [[maybe_unused]] auto const first_move = move_list;
   auto const own_pieces = p.pieces_by_color_[ToMove];
-  auto const opposing_pieces = p.pieces_by_color_[opposing_color<ToMove>()];
+  auto const opposing_pieces = p.pieces_by_color_[them];
   auto const all_pieces = own_pieces | opposing_pieces;
+  auto const king = p.pieces<ToMove, piece_type::KING>();
+  auto const king_square_idx = cista::trailing_zeros(king);
 
-  auto const call_f_for_valid_move =
-      [&](bitboard const from, bitboard const to,
-          special_move const sm = special_move::NONE,
-          promotion_piece_type const promotion_piece =
-              promotion_piece_type::BISHOP) {
-        if (is_valid_move(from, to, sm)) {
-          *move_list++ = move{from, to, sm, promotion_piece};
-        }
-      };
-
-  auto const move_pawn_with_promotion_check =
-      [&](bitboard const from, bitboard const to,
-          special_move const type = special_move::NONE) {
-        if (to & (full_rank_bitboard(R1) | full_rank_bitboard(R8))) {
-          call_f_for_valid_move(from, to, special_move::PROMOTION,
-                                promotion_piece_type::KNIGHT);
-          call_f_for_valid_move(from, to, special_move::PROMOTION,
-                                promotion_piece_type::ROOK);
-          call_f_for_valid_move(from, to, special_move::PROMOTION,
-                                promotion_piece_type::BISHOP);
-          call_f_for_valid_move(from, to, special_move::PROMOTION,
-                                promotion_piece_type::QUEEN);
+  auto const add_moves = [&](bitboard const from, bitboard const targets) {
+    for_each_set_bit(targets, [&](bitboard const to) {
+      *move_list++ = move{from, to, special_move::NONE,
+                          promotion_piece_type::BISHOP};
+    });
+  };
+
+  auto const stage_target = (captures ? opposing_pieces : bitboard{0U}) |
+                            (quiets ? ~all_pieces : bitboard{0U});
+  auto const legal = check_mask<ToMove>(p, king_square_idx);
+  auto const target = stage_target & legal;
+  if (legal != 0U) {
+    auto const pinned = pinned_pieces<ToMove>(p, king_square_idx);
+    auto const legal_targets = [&](bitboard const from) {
+      return from & pinned ? target & pin_mask(king_square_idx, from)
+                           : target;
+    };
+
+    auto const promotion_rank = full_rank_bitboard(ToMove == WHITE ? R8 : R1);
+    // Promotions belong to the captures stage, even without a capture.
+    auto const push_mask = (quiets ? ~promotion_rank : bitboard{0U}) |
+                           (captures ? promotion_rank : bitboard{0U});
+    auto const add_pawn_moves = [&](bitboard const destinations,
+                                    int const shift) {
+      for_each_set_bit(destinations, [&](bitboard const to) {
+        auto const from = shift > 0 ? to << shift : to >> -shift;
+        if (to & promotion_rank) {
+          for (auto const ppt :
+               {promotion_piece_type::KNIGHT, promotion_piece_type::ROOK,
+                promotion_piece_type::BISHOP, promotion_piece_type::QUEEN}) {
+            *move_list++ = move{from, to, special_move::PROMOTION, ppt};
+          }
         } else {
-          call_f_for_valid_move(from, to);
+          *move_list++ = move{from, to, special_move::NONE,
+                              promotion_piece_type::BISHOP};
         }
-      };
-
-  auto const pawns = p.pieces<ToMove, piece_type::PAWN>();
-  auto const single_jump_pawn_destinations =
-      (ToMove == color::WHITE ? pawns >> 8 : pawns << 8) & ~all_pieces;
-  auto const single_jump_pawns = ToMove == color::WHITE
-                                     ? single_jump_pawn_destinations << 8
-                                     : single_jump_pawn_destinations >> 8;
-  auto const double_jump_pawn_destinations =
-      (ToMove == color::WHITE ? single_jump_pawns >> 16
-                              : single_jump_pawns << 16) &
-      ~all_pieces;
-  auto const double_jump_pawns =
-      second_rank[ToMove] &
-      (ToMove == color::WHITE ? double_jump_pawn_destinations << 16
-                              : double_jump_pawn_destinations >> 16);
-
-  for_each_set_bit(single_jump_pawns, [&](bitboard const pawn) {
-    move_pawn_with_promotion_check(
-        pawn, ToMove == color::WHITE ? pawn >> 8 : pawn << 8);
-  });
+      });
+    };
+
+    // Shifts are relative to the destination square (to -> from).
+    auto const generate_pawn_moves = [&](bitboard const pawns,
+                                         bitboard const mask) {
+      auto const single = (ToMove == WHITE ? pawns >> 8 : pawns << 8) &
+                          ~all_pieces;
+      auto const double_jump =
+          (ToMove == WHITE ? (single & full_rank_bitboard(R3)) >> 8
+                           : (single & full_rank_bitboard(R6)) << 8) &
+          ~all_pieces;
+      auto const right_capture = (ToMove == WHITE ? pawns >> 7 : pawns << 9) &
+                                 ~full_file_bitboard(FA) & opposing_pieces;
+      auto const left_capture = (ToMove == WHITE ? pawns >> 9 : pawns << 7) &
+                                ~full_file_bitboard(FH) & opposing_pieces;
+      add_pawn_moves(single & push_mask & mask, ToMove == WHITE ? 8 : -8);
+      if constexpr (quiets) {
+        add_pawn_moves(double_jump & mask, ToMove == WHITE ? 16 : -16);
+      }
+      if constexpr (captures) {
+        add_pawn_moves(right_capture & mask, ToMove == WHITE ? 7 : -9);
+        add_pawn_moves(left_capture & mask, ToMove == WHITE ? 9 : -7);
+      }
+    };
+
+    auto const pawns = p.pieces<ToMove, piece_type::PAWN>();
+    generate_pawn_moves(pawns & ~pinned, legal);
+    for_each_set_bit(pawns & pinned, [&](bitboard const pawn) {
+      generate_pawn_moves(pawn, legal & pin_mask(king_square_idx, pawn));
+    });
+
+    if (captures && p.en_passant_ != 0U) {
+      for_each_set_bit(pawns & pawn_attacks_bb(p.en_passant_, them),
+                       [&](bitboard const pawn) {
+                         if (is_en_passant_legal<ToMove>(p, pawn)) {
+                           add_moves(pawn, p.en_passant_);
+                         }
+                       });
+    }
 
-  for_each_set_bit(double_jump_pawns, [&](bitboard const pawn) {
-    call_f_for_valid_move(pawn,
-                          ToMove == color::WHITE ? pawn >> 16 : pawn << 16);
-  });
+    for_each_set_bit(
+        p.pieces<ToMove, piece_type::KNIGHT>() & ~pinned,
+        [&](bitboard const knight) {
+          add_moves(knight, knight_attacks_by_origin_square
+                                    [cista::trailing_zeros(knight)] &
+                                target);
+        });
+
+    for_each_set_bit(
+        p.pieces<ToMove, piece_type::BISHOP>(), [&](bitboard const bishop) {
+          add_moves(bishop, get_attack_squares<BISHOP>(bishop, all_pieces) &
+                                legal_targets(bishop));
+        });
+
+    for_each_set_bit(
+        p.pieces<ToMove, piece_type::ROOK>(), [&](bitboard const rook) {
+          add_moves(rook, get_attack_squares<ROOK>(rook, all_pieces) &
+                              legal_targets(rook));
+        });
+
+    for_each_set_bit(
+        p.pieces<ToMove, piece_type::QUEEN>(), [&](bitboard const queen) {
+          add_moves(queen, (get_attack_squares<ROOK>(queen, all_pieces) |
+                            get_attack_squares<BISHOP>(queen, all_pieces)) &
+                               legal_targets(queen));
+        });
+  }
 
-  auto const pawn_right_capture_destinations =
-      (ToMove == color::WHITE ? pawns >> 7 : pawns << 9) &
-      (opposing_pieces | p.en_passant_) & ~full_file_bitboard(FA);
-  auto const right_capture_pawns = ToMove == color::WHITE
-                                       ? pawn_right_capture_destinations << 7
-                                       : pawn_right_capture_destinations >> 9;
-  for_each_set_bit(right_capture_pawns, [&](bitboard const pawn) {
-    auto const right_capture = ToMove == color::WHITE ? pawn >> 7 : pawn << 9;
-    move_pawn_with_promotion_check(pawn, right_capture);
-  });
+  add_moves(king, king_attacks_by_origin_square[king_square_idx] &
+                      stage_target &
+                      ~attacked_squares<them>(p, all_pieces ^ king));
 
-  auto const pawn_left_capture_destinations =
-      (ToMove == color::WHITE ? pawns >> 9 : pawns << 7) &
-      (opposing_pieces | p.en_passant_) & ~full_file_bitboard(FH);
-  auto const left_capture_pawns = ToMove == color::WHITE
-                                      ? pawn_left_capture_destinations << 9
-                                      : pawn_left_capture_destinations >> 7;
-  for_each_set_bit(left_capture_pawns, [&](bitboard const pawn) {
-    auto const left_capture = ToMove == color::WHITE ? pawn >> 9 : pawn << 7;
-    move_pawn_with_promotion_check(pawn, left_capture);
-  });
+  if (quiets && p.checkers_[ToMove] == 0U) {
+    auto const first_rank = ToMove == color::WHITE ? R1 : R8;
+    if (is_short_castle_legal<ToMove>(p)) {
+      *move_list++ = move{king, rank_file_to_bitboard(first_rank, FH),
+                          special_move::CASTLE};
+    }
+    if (is_long_castle_legal<ToMove>(p)) {
+      *move_list++ = move{king, rank_file_to_bitboard(first_rank, FA),
+                          special_move::CASTLE};
+    }
+  }
 
-  for_each_set_bit(
-      p.pieces<ToMove, piece_type::KNIGHT>(), [&](bitboard const knight) {
-        for_each_set_bit(
-            knight_attacks_by_origin_square[cista::trailing_zeros(knight)] &
-                ~own_pieces,
-            [&](bitboard const target) {
-              call_f_for_valid_move(knight, target);
-            });
-      });
+  if constexpr (GenType == gen_type::QUIET_CHECKS) {
+    move_list = std::remove_if(first_move, move_list, [&](move const m) {
+      return !gives_check<ToMove>(p, m);
+    });
+  }
 
-  for_each_set_bit(
-      p.pieces<ToMove, piece_type::BISHOP>(), [&](bitboard const bishop) {
-        for_each_set_bit(
-            get_attack_squares<piece_type::BISHOP>(bishop, all_pieces) &
-                ~own_pieces,
-            [&](bitboard const attack_square) {
-              call_f_for_valid_move(bishop, attack_square);
-            });
-      });
+  return move_list;
+}
 
-  for_each_set_bit(
-      p.pieces<ToMove, piece_type::ROOK>(), [&](bitboard const rook) {
-        for_each_set_bit(
-            get_attack_squares<piece_type::ROOK>(rook, all_pieces) &
-                ~own_pieces,
-            [&](bitboard const attack_square) {
-              call_f_for_valid_move(rook, attack_square);
-            });
-      });
+template <gen_type GenType = gen_type::ALL>
+move* generate_moves(position const& p, move* move_list) {
+  return p.to_move_ == color::WHITE
+             ? generate_moves<color::WHITE, GenType>(p, move_list)
+             : generate_moves<color::BLACK, GenType>(p, move_list);
+}
 
-  for_each_set_bit(
-      p.pieces<ToMove, piece_type::QUEEN>(), [&](bitboard const queen) {
-        for_each_set_bit(
-            (get_attack_squares<piece_type::ROOK>(queen, all_pieces) |
-             get_attack_squares<piece_type::BISHOP>(queen, all_pieces)) &
-                ~own_pieces,
-            [&](bitboard const attack_square) {
-              call_f_for_valid_move(queen, attack_square);
-            });
-      });
+inline bool gives_check(position const& p, move const m) {
+  return p.to_move_ == color::WHITE ? gives_check<color::WHITE>(p, m)
+                                    : gives_check<color::BLACK>(p, m);
+}
 
+// Number of legal moves without materializing them: popcount of the legal
+// destinations of each piece (promotions count four times).
+template <color ToMove>
+unsigned count_moves(position const& p) {
+  constexpr auto const them = opposing_color<ToMove>();
+  auto const own_pieces = p.pieces_by_color_[ToMove];
+  auto const opposing_pieces = p.pieces_by_color_[them];
+  auto const all_pieces = own_pieces | opposing_pieces;
   auto const king = p.pieces<ToMove, piece_type::KING>();
-  for_each_set_bit(
-      king_attacks_by_origin_square[cista::trailing_zeros(king)] & ~own_pieces,
-      [&](bitboard const target) { call_f_for_valid_move(king, target); });
+  auto const king_square_idx = cista::trailing_zeros(king);
 
-  auto const can_short_castle = [&]() {
-    if (!p.can_short_castle<ToMove>()) {
-      return false;
-    }
-
-    if ((short_castle_rook_traversal_squares[ToMove] & all_pieces) ||
-        (short_castle_knight_attack_squares[ToMove] & opposing_knights) ||
-        (short_castle_pawn_king_attack_squares[ToMove] &
-         (opposing_king | opposing_pawns))) {
-      return false;
-    }
+  auto const attacked = attacked_squares<them>(p, all_pieces ^ king);
+  auto n = static_cast<unsigned>(std::popcount(
+      king_attacks_by_origin_square[king_square_idx] & ~own_pieces &
+      ~attacked));
 
-    for (auto const king_traversal_square :
-         short_castle_king_traversal_squares[ToMove]) {
-      if (get_attack_squares<ROOK>(king_traversal_square, all_pieces) &
-              opposing_streight_movers ||
-          get_attack_squares<BISHOP>(king_traversal_square, all_pieces) &
-              opposing_diagonal_movers) {
-        return false;
-      }
-    }
+  auto const target = ~own_pieces & check_mask<ToMove>(p, king_square_idx);
+  if (target == 0U) {
+    return n;
+  }
 
-    return true;
+  auto const pinned = pinned_pieces<ToMove>(p, king_square_idx);
+  auto const count = [&](bitboard const from, bitboard const to) {
+    n += std::popcount(from & pinned ? to & pin_mask(king_square_idx, from)
+                                     : to);
   };
 
-  auto const can_long_castle = [&]() {
-    if (!p.can_long_castle<ToMove>()) {
-      return false;
-    }
+  for_each_set_bit(p.pieces<ToMove, piece_type::KNIGHT>() & ~pinned,
+                   [&](bitboard const knight) {
+                     n += std::popcount(knight_attacks_by_origin_square
+                                            [cista::trailing_zeros(knight)] &
+                                        target);
+                   });
 
-    if ((long_castle_rook_traversal_squares[ToMove] & all_pieces) ||
-        (long_castle_knight_attack_squares[ToMove] & opposing_knights) ||
-        (long_castle_pawn_king_attack_squares[ToMove] &
-         (opposing_king | opposing_pawns))) {
-      return false;
-    }
+  auto const queens = p.pieces<ToMove, piece_type::QUEEN>();
+  for_each_set_bit(
+      p.pieces<ToMove, piece_type::BISHOP>() | queens, [&](bitboard const b) {
+        count(b, get_attack_squares<BISHOP>(b, all_pieces) & target);
+      });
+  for_each_set_bit(
+      p.pieces<ToMove, piece_type::ROOK>() | queens, [&](bitboard const r) {
+        count(r, get_attack_squares<ROOK>(r, all_pieces) & target);
+      });
 
-    for (auto const king_traversal_square :
-         long_castle_king_traversal_squares[ToMove]) {
-      if ((get_attack_squares<ROOK>(king_traversal_square, all_pieces) &
-           opposing_streight_movers) ||
-          (get_attack_squares<BISHOP>(king_traversal_square, all_pieces) &
-           opposing_diagonal_movers)) {
-        return false;
-      }
+  // Destinations are distinct per direction, so all pawns that share the
+  // same mask are counted at once.
+  auto const promotion_rank = full_rank_bitboard(ToMove == WHITE ? R8 : R1);
+  auto const count_pawns = [&](bitboard const pawns, bitboard const mask) {
+    auto const single = (ToMove == WHITE ? pawns >> 8 : pawns << 8) &
+                        ~all_pieces;
+    auto const double_jump =
+        (ToMove == WHITE ? (single & full_rank_bitboard(R3)) >> 8
+                         : (single & full_rank_bitboard(R6)) << 8) &
+        ~all_pieces;
+    auto const right_capture =
+        (ToMove == WHITE ? pawns >> 7 : pawns << 9) & ~full_file_bitboard(FA);
+    auto const left_capture =
+        (ToMove == WHITE ? pawns >> 9 : pawns << 7) & ~full_file_bitboard(FH);
+    for (auto const to : {single & mask, double_jump & mask,
+                          right_capture & opposing_pieces & mask,
+                          left_capture & opposing_pieces & mask}) {
+      n += std::popcount(to) + 3 * std::popcount(to & promotion_rank);
     }
-
-    return true;
   };
+  auto const pawns = p.pieces<ToMove, piece_type::PAWN>();
+  count_pawns(pawns & ~pinned, target);
+  for_each_set_bit(pawns & pinned, [&](bitboard const pawn) {
+    count_pawns(pawn, target & pin_mask(king_square_idx, pawn));
+  });
 
-  auto const active_player_first_rank = ToMove == color::WHITE ? R1 : R8;
-  if (can_short_castle()) {
-    *move_list++ = move{rank_file_to_bitboard(active_player_first_rank, FE),
-                        rank_file_to_bitboard(active_player_first_rank, FH),
-                        special_move::CASTLE};
+  if (p.en_passant_ != 0U) {
+    for_each_set_bit(pawns & pawn_attacks_bb(p.en_passant_, them),
+                     [&](bitboard const pawn) {
+                       n += is_en_passant_legal<ToMove>(p, pawn) ? 1U : 0U;
+                     });
   }
 
-  if (can_long_castle()) {
-    *move_list++ = move{rank_file_to_bitboard(active_player_first_rank, FE),
-                        rank_file_to_bitboard(active_player_first_rank, FA),
-                        special_move::CASTLE};
+  if (p.checkers_[ToMove] == 0U) {
+    n += is_short_castle_legal<ToMove>(p) ? 1U : 0U;
+    n += is_long_castle_legal<ToMove>(p) ? 1U : 0U;
   }
 
-  return move_list;
+  return n;
 }
 
-inline move* generate_moves(position const& p, move* move_list) {
-  return p.to_move_ == color::WHITE
-             ? generate_moves<color::WHITE>(p, move_list)
-             : generate_moves<color::BLACK>(p, move_list);
+inline unsigned count_moves(position const& p) {
+  return p.to_move_ == color::WHITE ? count_moves<color::WHITE>(p)
+                                    : count_moves<color::BLACK>(p);
 }
 
 }  // namespace chessbot
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+#include "chessbot/move.h"
+#include "chessbot/position.h"
+#include "chessbot/zobrist.h"
+
+namespace chessbot {
+
+// Contiguous, preallocated move history of a search or game.
+//
+// hashes_[i] is the hash before the i-th ply. The first entries are taken
+// from the state_info chain the history was started from (only as many as
+// the half move clock can reach), followed by one entry per pushed move.
+// states_ holds the state_info of every pushed move. They are still linked
+// through prev_state_info_ (the first one to the root state) so code
+// walking the chain keeps working.
+struct history {
+  history() = default;
+  history(position const& root, state_info const* root_info,
+          unsigned max_plies);
+
+  history(history const&);
+  history& operator=(history const&);
+  history(history&&) = default;
+  history& operator=(history&&) = default;
+  ~history() = default;
+
+  void push(position& p, move const m) {
+    assert(states_.size() < states_.capacity());
+    hashes_.push_back(p.hash_);
+    states_.emplace_back(p.make_move(m, last_state()));
+  }
+
+  void push_null(position& p) {
+    assert(states_.size() < states_.capacity());
+    hashes_.push_back(p.hash_);
+    states_.emplace_back(p.make_null_move(last_state()));
+  }
+
+  void pop(position& p) {
+    auto const& s = states_.back();
+    if (s.last_move_.is_initialized()) {
+      p.unmake_move(s.last_move_, s);
+    } else {
+      p.unmake_null_move(s);
+    }
+    states_.pop_back();
+    hashes_.pop_back();
+  }
+
+  // Number of earlier occurrences of p. Only positions with the same side
+  // to move (every other ply) inside the half move clock window can repeat.
+  unsigned count_repetitions(position const& p) const {
+    auto const n = hashes_.size();
+    auto const window = std::min(size_t{p.half_move_clock_}, n);
+    auto repetitions = 0U;
+    for (auto i = size_t{2U}; i <= window; i += 2U) {
+      repetitions += hashes_[n - i] == p.hash_ ? 1U : 0U;
+    }
+    return repetitions;
+  }
+
+  state_info const* last_state() const {
+    return states_.empty() ? root_info_ : &states_.back();
+  }
+
+  size_t size() const { return states_.size(); }
+  bool empty() const { return states_.empty(); }
+
+  std::vector<zobrist_t> hashes_;
+  std::vector<state_info> states_;
+  state_info const* root_info_{nullptr};
+};
+
+}  // namespace chessbot
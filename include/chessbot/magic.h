@@ -4,6 +4,10 @@
 #include <array>
 #include <bit>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 #include "cista/bit_counting.h"
 
 #include "utl/enumerate.h"
@@ -12,68 +16,123 @@
 
 namespace chessbot {
 
-constexpr auto const magic_number_num_bits = 14U;
+// Relevant occupancy bits: at most 12 (rook on a corner), 9 for bishops.
+constexpr auto const max_magic_bits = 12U;
+
+// Sum of 2^(relevant bits) over all squares.
+constexpr auto const rook_magic_table_size = 102400U;
+constexpr auto const bishop_magic_table_size = 5248U;
 
 extern std::array<bitboard, 64> bishop_attack_bbs;
 extern std::array<bitboard, 64> rook_attack_bbs;
 
-std::array<int8_t, magic_number_num_bits> get_set_bit_indices(bitboard);
+std::array<int8_t, max_magic_bits> get_set_bit_indices(bitboard);
 
+// Calls f for every subset of bb (carry-rippler), stops if f returns true.
 template <typename Fn>
 void for_all_permutations(bitboard const bb, Fn&& f) {
-  auto const set_bit_indices = get_set_bit_indices(bb);
-  auto const number_of_ones = std::popcount(bb);
-  for (auto i = bitboard{0U}; i < (1U << number_of_ones); ++i) {
-    auto occupancy_bb = bitboard{0U};
-    for (auto const [j, set_bit_idx] : utl::enumerate(set_bit_indices)) {
-      if (set_bit_idx == -1) {
-        break;
-      }
-      occupancy_bb |= ((i >> j) & ~(full_bitboard - 1)) << set_bit_idx;
-    }
+  auto occupancy_bb = bitboard{0U};
+  do {
     if (f(occupancy_bb)) {
-      goto error;
+      return;
     }
-  }
-
-error:
-  return;
+    occupancy_bb = (occupancy_bb - bb) & bb;
+  } while (occupancy_bb != 0U);
 }
 
-extern std::array<uint64_t, 64U> bishop_square_magic_numbers;
+// Attack squares for square i are stored at
+// magic_attack_squares[offset_ + ((occupancy & mask_) * number_ >> shift_)].
+struct magic {
+  bitboard mask_;
+  uint64_t number_;
+  unsigned offset_;
+  unsigned shift_;
+};
+
+extern std::array<magic, 64U> rook_magics;
+extern std::array<magic, 64U> bishop_magics;
+
+extern std::array<bitboard, rook_magic_table_size + bishop_magic_table_size>
+    magic_attack_squares;
+
+// Index function used for magic_attack_squares. PEXT (BMI2) replaces the
+// multiply-shift by a parallel bit extract of the relevant occupancy.
+enum class slider_backend : uint8_t { MAGIC, PEXT };
+
+extern slider_backend active_slider_backend;
+
+// PEXT if the CPU supports BMI2, MAGIC otherwise.
+slider_backend default_slider_backend();
 
-extern std::array<uint64_t, 64U> rook_square_magic_numbers;
+// Fills magic_attack_squares for the active backend (done once during
+// static initialization).
+void build_magic_attack_table();
 
-extern std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-    magic_bishop_attack_squares;
+// Not thread-safe: rebuilds the table, no lookups may run concurrently.
+void set_slider_backend(slider_backend);
 
-extern std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-    magic_rook_attack_squares;
+// Ray scans used to build the table and to search new magic numbers.
+bitboard rook_attack_squares(bitboard square, bitboard occupancy);
+bitboard bishop_attack_squares(bitboard square, bitboard occupancy);
+uint64_t guess_magic_number(unsigned square_idx, piece_type, bitboard mask);
+
+inline constexpr unsigned get_magic_index(bitboard const occupancy,
+                                          magic const& m) {
+  return m.offset_ +
+         static_cast<unsigned>(((occupancy & m.mask_) * m.number_) >> m.shift_);
+}
+
+// Portable bit extract, same result as the BMI2 pext instruction.
+inline constexpr uint64_t pext_sw(uint64_t const source, uint64_t const mask) {
+  auto result = uint64_t{0U};
+  auto bit = uint64_t{1U};
+  for (auto m = mask; m != 0U; m &= m - 1U, bit <<= 1U) {
+    if (source & m & ~(m - 1U)) {
+      result |= bit;
+    }
+  }
+  return result;
+}
+
+// Requires BMI2 on x86_64 (see cpu_has_bmi2()).
+inline uint64_t pext(uint64_t const source, uint64_t const mask) {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+  auto result = uint64_t{};
+  asm("pextq %2, %1, %0" : "=r"(result) : "r"(source), "r"(mask));
+  return result;
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return _pext_u64(source, mask);
+#else
+  // Never selected (no BMI2), only here to keep the code portable.
+  return pext_sw(source, mask);
+#endif
+}
+
+inline unsigned get_pext_index(bitboard const occupancy, magic const& m) {
+  return m.offset_ + static_cast<unsigned>(pext(occupancy, m.mask_));
+}
 
-inline constexpr unsigned get_magic_index(bitboard const occupancy_permutation,
-                                          uint64_t const magic_number) {
-  return (occupancy_permutation * magic_number) >> (64 - magic_number_num_bits);
+inline unsigned get_slider_index(bitboard const occupancy, magic const& m) {
+  return active_slider_backend == slider_backend::PEXT
+             ? get_pext_index(occupancy, m)
+             : get_magic_index(occupancy, m);
 }
 
 template <piece_type>
 bitboard get_attack_squares(bitboard square, bitboard occupancy);
 
 template <>
-inline constexpr bitboard get_attack_squares<piece_type::ROOK>(
+inline bitboard get_attack_squares<piece_type::ROOK>(
     bitboard const square, bitboard const occupancy) {
-  auto const square_idx = cista::trailing_zeros(square);
-  return magic_rook_attack_squares[square_idx][get_magic_index(
-      rook_attack_bbs[square_idx] & occupancy,
-      rook_square_magic_numbers[square_idx])];
+  return magic_attack_squares[get_slider_index(
+      occupancy, rook_magics[cista::trailing_zeros(square)])];
 }
 
 template <>
-inline constexpr bitboard get_attack_squares<piece_type::BISHOP>(
+inline bitboard get_attack_squares<piece_type::BISHOP>(
     bitboard const square, bitboard const occupancy) {
-  auto const square_idx = cista::trailing_zeros(square);
-  return magic_bishop_attack_squares[square_idx][get_magic_index(
-      bishop_attack_bbs[square_idx] & occupancy,
-      bishop_square_magic_numbers[square_idx])];
+  return magic_attack_squares[get_slider_index(
+      occupancy, bishop_magics[cista::trailing_zeros(square)])];
 }
 
 }  // namespace chessbot
\ No newline at end of file
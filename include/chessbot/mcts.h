@@ -1,14 +1,19 @@
 #pragma once
 
+#include <cmath>
 #include <numeric>
 
+#include "chessbot/eval.h"
 #include "chessbot/generate_moves.h"
 #include "chessbot/position.h"
 #include "chessbot/util.h"
 
 namespace chessbot {
 
-float evaluate(position const& p) { return ((double)rand() / (RAND_MAX)); }
+// Expected score of the side that just moved, from the tapered evaluation.
+float evaluate(position const& p) {
+  return 1.0F / (1.0F + std::exp(static_cast<float>(tapered_eval(p)) / 400.0F));
+}
 
 void indent(unsigned const depth) {
   for (auto i = 0; i < depth; ++i) {
@@ -51,11 +56,11 @@ unsigned mcts(position const& p, unsigned const number_of_games,
   }
 
   auto i = 0U;
-  auto next_pos = position{};
+  auto next_pos = p;
   for (auto it = begin; it != end; ++it, ++i) {
-    next_pos = p;
-    next_pos.make_move(*it, info_ptr);
+    auto const s = next_pos.make_move(*it, info_ptr);
     evaluations[i] = evaluate(next_pos);
+    next_pos.unmake_move(*it, s);
   }
 
   auto const sum_of_evaluation =
@@ -109,13 +114,13 @@ unsigned mcts(position const& p, unsigned const number_of_games,
                 << sum_of_evaluation << "]\n";
     }
 
-    next_pos = p;
     auto child_state_info = next_pos.make_move(move_list[i], info_ptr);
     auto next_moves = std::array<move, max_moves>{};
     auto next_end_evaluations = std::array<float, max_moves>{};
     points[i] =
         mcts<false, PrintDebug>(next_pos, contingents[i], &child_state_info,
                                 next_moves, next_end_evaluations, depth + 1);
+    next_pos.unmake_move(move_list[i], child_state_info);
     called = true;
   }
 
@@ -125,7 +130,6 @@ unsigned mcts(position const& p, unsigned const number_of_games,
     auto const best_move_idx =
         std::distance(std::begin(evaluations), best_move_it);
 
-    next_pos = p;
     auto child_state_info =
         next_pos.make_move(move_list[best_move_idx], info_ptr);
     auto next_moves = std::array<move, max_moves>();
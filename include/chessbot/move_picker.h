@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <cstdlib>
+
+#include "chessbot/constants.h"
+#include "chessbot/eval.h"
+#include "chessbot/move.h"
+#include "chessbot/position.h"
+
+namespace chessbot {
+
+inline bool is_capture(position const& p, move const m) {
+  return (m.to() & p.pieces_by_color_[p.opposing_color()]) != 0U ||
+         (m.to() == p.en_passant_ && (m.from() & p.piece_states_[PAWN]));
+}
+
+// Captures and promotions are searched with the good captures.
+inline bool is_quiet_move(position const& p, move const m) {
+  return m.special_move_ != special_move::PROMOTION && !is_capture(p, m);
+}
+
+// Material the move wins if it isn't recaptured (promotions count as
+// queen promotions).
+inline score_t capture_value(position const& p, move const m) {
+  auto value = score_t{0};
+  if ((m.to() & p.pieces_by_color_[p.opposing_color()]) != 0U) {
+    value = piece_values[p.piece_on(m.to())];
+  } else if (m.to() == p.en_passant_ && (m.from() & p.piece_states_[PAWN])) {
+    value = piece_values[PAWN];
+  }
+  if (m.special_move_ == special_move::PROMOTION) {
+    value += piece_values[QUEEN] - piece_values[PAWN];
+  }
+  return value;
+}
+
+// Most valuable victim first, then least valuable attacker.
+inline score_t mvv_lva(position const& p, move const m) {
+  return capture_value(p, m) * 8 - p.piece_on(m.from());
+}
+
+// Quiet move ordering state of one search thread: two killer moves per ply
+// (quiet moves that caused a beta cutoff in a sibling node) and the
+// butterfly history (cutoff statistics by side, origin and destination).
+struct move_ordering {
+  static constexpr auto const max_history = 16384;
+
+  void clear() {
+    killers_ = {};
+    history_ = {};
+  }
+
+  void update_killers(unsigned const ply, move const m) {
+    if (killers_[ply][0] != m) {
+      killers_[ply][1] = killers_[ply][0];
+      killers_[ply][0] = m;
+    }
+  }
+
+  // Positive bonus for the cutoff move, negative for the quiets tried
+  // before it. Saturates at +/-max_history.
+  void update_history(color const c, move const m, int const bonus) {
+    auto& h = history_[c][m.from_field_][m.to_field_];
+    h += bonus - h * std::abs(bonus) / max_history;
+  }
+
+  int history(color const c, move const m) const {
+    return history_[c][m.from_field_][m.to_field_];
+  }
+
+  std::array<std::array<move, 2>, max_search_ply> killers_{};
+  std::array<std::array<std::array<int, 64>, 64>, 2> history_{};
+};
+
+// Lazy staged move picker. Yields the hash move, captures and promotions
+// that don't lose material (by MVV-LVA, checked with SEE when picked),
+// killers, the remaining quiets by history and finally the losing
+// captures. Moves are only generated (and sorted by selection) when their
+// stage is reached, so a cutoff on the hash move or a capture saves the
+// rest. next() returns move{} when done.
+//
+// With captures_only, only the good captures are yielded (no hash move,
+// no quiets, no losing captures) as needed by quiescence search.
+struct move_picker {
+  move_picker(position const&, move hash_move, move_ordering const*,
+              unsigned ply, bool captures_only = false);
+
+  move next();
+
+private:
+  enum class stage : uint8_t {
+    HASH_MOVE,
+    GENERATE_CAPTURES,
+    GOOD_CAPTURES,
+    GENERATE_QUIETS,
+    KILLERS,
+    QUIETS,
+    BAD_CAPTURES,
+    DONE
+  };
+
+  struct scored_move {
+    move move_;
+    int score_;
+  };
+
+  void generate_captures();
+  void generate_quiets();
+  bool is_skipped(move) const;
+
+  position const& p_;
+  move hash_move_;
+  move_ordering const* ordering_;
+  unsigned ply_;
+  bool captures_only_;
+  stage stage_;
+  unsigned killer_idx_{0U};
+
+  // Losing captures are moved to the back of the capture list.
+  std::array<scored_move, max_moves> captures_, quiets_;
+  scored_move* cur_{nullptr};
+  scored_move *captures_end_{nullptr}, *bad_captures_begin_{nullptr};
+  scored_move* quiets_end_{nullptr};
+};
+
+}  // namespace chessbot
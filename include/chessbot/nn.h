@@ -1,11 +1,19 @@
 #pragma once
 
+#include <cassert>
+#include <cinttypes>
 #include <cmath>
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <span>
 #include <tuple>
+#include <type_traits>
+#include <vector>
 
 #include "chessbot/optimizer.h"
 #include "chessbot/real_t.h"
+#include "chessbot/thread_pool.h"
 #include "chessbot/sigmoid.h"
 
 namespace chessbot {
@@ -37,6 +45,38 @@ inline real_t scale_from_output(real_t const min, real_t const max,
 // inline real_t activation_fn(real_t const t) { return std::max(0.0, t); }
 // inline real_t activation_fn_d(real_t const t) { return t <= 0 ? 0 : 1; }
 
+// out += factor * in. The rows must not overlap, which lets the compiler
+// vectorize without runtime alias checks.
+template <size_t N>
+inline void multiply_add(std::array<real_t, N>& __restrict out,
+                         real_t const factor,
+                         std::array<real_t, N> const& __restrict in) {
+  for (auto i = size_t{0U}; i < N; ++i) {
+    out[i] += factor * in[i];
+  }
+}
+
+// Input vector with at most Capacity entries set to 1, all others 0 (e.g.
+// one-hot board features). Stores the indices of the active entries.
+template <unsigned InputSize, unsigned Capacity>
+struct sparse_input {
+  void push_back(unsigned const idx) {
+    assert(size_ < Capacity && idx < InputSize);
+    indices_[size_++] = static_cast<uint16_t>(idx);
+  }
+
+  std::array<real_t, InputSize> to_dense() const {
+    auto dense = std::array<real_t, InputSize>{};
+    for (auto k = 0U; k != size_; ++k) {
+      dense[indices_[k]] = 1.0;
+    }
+    return dense;
+  }
+
+  std::array<uint16_t, Capacity> indices_{};
+  unsigned size_{0U};
+};
+
 template <unsigned InputSize, unsigned LayerSize>
 struct layer {
   static constexpr auto const input_size = InputSize;
@@ -90,9 +130,37 @@ struct layer {
     return output;
   }
 
+  // Sparse input: inactive inputs are 0, active ones are active_value.
+  // Only the columns of the active inputs are read.
+  template <unsigned Capacity>
+  std::array<real_t, LayerSize> net(
+      sparse_input<InputSize, Capacity> const& input,
+      real_t const active_value) const {
+    auto output = std::array<real_t, LayerSize>{};
+    for (auto i = 0U; i < LayerSize; ++i) {
+      auto sum = real_t{0.0};
+      for (auto k = 0U; k < input.size_; ++k) {
+        sum += weights_[i][input.indices_[k]];
+      }
+      output[i] = sum * active_value + bias_weight_[i];
+    }
+    return output;
+  }
+
   std::array<real_t, LayerSize> estimate(
       std::array<real_t, InputSize> const& input) const {
-    auto n = net(input);
+    return activate(net(input));
+  }
+
+  template <unsigned Capacity>
+  std::array<real_t, LayerSize> estimate(
+      sparse_input<InputSize, Capacity> const& input,
+      real_t const active_value) const {
+    return activate(net(input, active_value));
+  }
+
+  static std::array<real_t, LayerSize> activate(
+      std::array<real_t, LayerSize> n) {
     for (auto& x : n) {
       x = activation_fn(x);
     }
@@ -106,7 +174,7 @@ struct layer {
       const {
     auto deltas = std::array<real_t, LayerSize>{};
     for (auto j = 0U; j < LayerSize; ++j) {
-      auto sum = 0.0F;
+      auto sum = real_t{0.0};
       for (auto k = 0U; k < next_layer_deltas.size(); ++k) {
         sum += next_layer_deltas[k] * next.weights_[k][j];
       }
@@ -138,6 +206,103 @@ struct layer {
     }
   }
 
+  // Sparse input: the gradient of all weights of inactive inputs is 0.
+  template <unsigned Capacity>
+  void update_weights(std::array<real_t, LayerSize> const& deltas,
+                      sparse_input<InputSize, Capacity> const& prev_layer_out,
+                      real_t const active_value, real_t const learning_rate) {
+    for (auto i = 0U; i < LayerSize; ++i) {
+      auto const d = (-learning_rate) * deltas[i];
+      for (auto k = 0U; k < prev_layer_out.size_; ++k) {
+        weights_[i][prev_layer_out.indices_[k]] += d * active_value;
+      }
+      bias_weight_[i] += d;
+    }
+  }
+
+  // Mini-batch versions of estimate, deltas and update_weights: row s of
+  // every matrix belongs to sample s. Samples are processed in blocks of
+  // block_samples so each weight row is loaded once per block instead of
+  // once per sample. Inner loops run over contiguous rows without
+  // reassociating sums, so they vectorize.
+  static constexpr auto const block_samples = size_t{4U};
+
+  using batch_input_t = std::vector<std::array<real_t, InputSize>>;
+  using batch_output_t = std::vector<std::array<real_t, LayerSize>>;
+
+  using transposed_t = std::vector<std::array<real_t, LayerSize>>;
+
+  // One row per input.
+  void transpose(transposed_t& transposed) const {
+    transposed.resize(InputSize);
+    for (auto i = 0U; i < LayerSize; ++i) {
+      for (auto j = 0U; j < InputSize; ++j) {
+        transposed[j][i] = weights_[i][j];
+      }
+    }
+  }
+
+  // transposed: weights from transpose().
+  void estimate(batch_input_t const& in, batch_output_t& out,
+                transposed_t const& transposed) const {
+    for (auto s0 = size_t{0U}; s0 < out.size(); s0 += block_samples) {
+      auto const s1 = std::min(s0 + block_samples, out.size());
+      for (auto s = s0; s != s1; ++s) {
+        out[s] = bias_weight_;
+      }
+      for (auto j = 0U; j < InputSize; ++j) {
+        auto const& w = transposed[j];
+        for (auto s = s0; s != s1; ++s) {
+          multiply_add(out[s], in[s][j], w);
+        }
+      }
+      for (auto s = s0; s != s1; ++s) {
+        out[s] = activate(out[s]);
+      }
+    }
+  }
+
+  template <typename NextLayer>
+  void deltas(NextLayer const& next, batch_output_t const& out,
+              typename NextLayer::batch_output_t const& next_layer_deltas,
+              batch_output_t& deltas) const {
+    constexpr auto const next_size = NextLayer::layer_size;
+    for (auto s0 = size_t{0U}; s0 < deltas.size(); s0 += block_samples) {
+      auto const s1 = std::min(s0 + block_samples, deltas.size());
+      for (auto s = s0; s != s1; ++s) {
+        deltas[s] = {};
+      }
+      for (auto k = 0U; k < next_size; ++k) {
+        auto const& w = next.weights_[k];
+        for (auto s = s0; s != s1; ++s) {
+          multiply_add(deltas[s], next_layer_deltas[s][k], w);
+        }
+      }
+      for (auto s = s0; s != s1; ++s) {
+        for (auto j = 0U; j < LayerSize; ++j) {
+          deltas[s][j] *= activation_fn_d(out[s][j]);
+        }
+      }
+    }
+  }
+
+  // Each weight row accumulates the whole batch before it is written back.
+  void update_weights(batch_output_t const& deltas,
+                      batch_input_t const& prev_layer_out,
+                      real_t const learning_rate) {
+    for (auto i = 0U; i < LayerSize; ++i) {
+      auto w = weights_[i];
+      auto bias = bias_weight_[i];
+      for (auto s = size_t{0U}; s < deltas.size(); ++s) {
+        auto const d = (-learning_rate) * deltas[s][i];
+        multiply_add(w, d, prev_layer_out[s]);
+        bias += d;
+      }
+      weights_[i] = w;
+      bias_weight_[i] = bias;
+    }
+  }
+
   std::array<std::array<real_t, InputSize>, LayerSize> weights_{};
   std::array<real_t, LayerSize> bias_weight_{};
 };
@@ -179,6 +344,29 @@ struct network {
   using input_t = std::array<real_t, InputSize>;
   using output_t = std::array<real_t, layer_sizes.back()>;
 
+  // Samples per block of train_batch. The layer outputs and deltas of a
+  // block fit in a 1 MB L2 cache.
+  static constexpr auto const batch_block_size = std::clamp(
+      (size_t{1U} << 20U) /
+          (2U * sizeof(real_t) * (InputSize + (LayerSizes + ...))),
+      size_t{1U}, size_t{16U});
+
+  // Scratch matrices for train_batch, one row per sample of a block.
+  struct batch {
+    using matrices_t =
+        std::tuple<std::vector<std::array<real_t, LayerSizes>>...>;
+
+    void resize(size_t const n) {
+      input_.resize(n);
+      std::apply([&](auto&... m) { (m.resize(n), ...); }, outputs_);
+      std::apply([&](auto&... m) { (m.resize(n), ...); }, deltas_);
+    }
+
+    std::vector<input_t> input_;  // scaled, only for dense input
+    matrices_t outputs_, deltas_;
+    matrices_t transposed_weights_;  // one row per layer input
+  };
+
   explicit network(real_t const min = 0.0, real_t const max = 1.0)
       : min_{min}, max_{max} {
     init_random();
@@ -215,6 +403,35 @@ struct network {
     return result;
   }
 
+  // Same as estimate(in.to_dense()). The first layer only reads the
+  // columns of the active inputs if inactive inputs scale to 0 (min_ = 0).
+  template <unsigned Capacity>
+  output_t estimate(sparse_input<InputSize, Capacity> const& in) const {
+    if (!is_sparse()) {
+      return estimate(in.to_dense());
+    }
+
+    auto result = forward<1U>(std::get<0>(layers_).estimate(
+        in, scale_from_output(min_, max_, 1.0)));
+    for (auto& r : result) {
+      r = scale_to_output(min_, max_, r);
+    }
+    return result;
+  }
+
+  // Applies layers I, I + 1, ... to the output of layer I - 1.
+  template <size_t I, typename In>
+  auto forward(In const& in) const {
+    if constexpr (I == number_of_layers) {
+      return in;
+    } else {
+      return forward<I + 1U>(std::get<I>(layers_).estimate(in));
+    }
+  }
+
+  // Whether inputs of 0 stay 0 after scaling.
+  bool is_sparse() const { return scale_from_output(min_, max_, 0.0) == 0.0; }
+
   template <size_t I,
             typename std::enable_if_t<I == number_of_layers>* = nullptr>
   void compute_outputs(layer_outputs_t&) {}
@@ -241,19 +458,15 @@ struct network {
     compute_deltas<I - 1>(outs, deltas);
   }
 
-  template <size_t I, typename std::enable_if_t<I == 0>* = nullptr>
+  // Updates layers I, I - 1, ..., Last.
+  template <size_t I, size_t Last = 0U>
   void update_weights(layers_tuple_t& layers, layer_outputs_t const& outs,
                       deltas_t const& deltas, real_t const learning_rate) {
     std::get<I>(layers).update_weights(std::get<I>(deltas), std::get<I>(outs),
                                        learning_rate);
-  }
-
-  template <size_t I, typename std::enable_if_t<I != 0>* = nullptr>
-  void update_weights(layers_tuple_t& layers, layer_outputs_t const& outs,
-                      deltas_t const& deltas, real_t const learning_rate) {
-    std::get<I>(layers).update_weights(std::get<I>(deltas), std::get<I>(outs),
-                                       learning_rate);
-    update_weights<I - 1>(layers, outs, deltas, learning_rate);
+    if constexpr (I != Last) {
+      update_weights<I - 1, Last>(layers, outs, deltas, learning_rate);
+    }
   }
 
   template <size_t BatchSize, size_t I = number_of_layers - 1>
@@ -292,18 +505,60 @@ struct network {
     }
   }
 
+  // Input is input_t or a sparse_input.
+  //
+  // With n_threads > 1, every batch is split into n_threads contiguous
+  // parts. Each part accumulates into its own gradient (part 0 into sum_),
+  // the parts are then added pairwise in a fixed tree order. The result
+  // only depends on n_threads, not on scheduling.
   template <template <typename> typename Optimizer = sgd, size_t BatchSize,
-            typename PlotFn>
-  void train_epoch(std::array<input_t, BatchSize> const& in,
+            typename Input, typename PlotFn>
+  void train_epoch(std::array<Input, BatchSize> const& in,
                    std::array<output_t, BatchSize> const& expected,
                    real_t const learning_rate, unsigned const outer_loop_size,
-                   PlotFn&& plot) {
+                   PlotFn&& plot, unsigned const n_threads = 1U) {
+    auto const n_parts = std::clamp(size_t{n_threads}, size_t{1U}, BatchSize);
+    auto gradients = std::vector<std::unique_ptr<layers_tuple_t>>(n_parts);
+    for (auto p = size_t{1U}; p < n_parts; ++p) {
+      gradients[p] = std::make_unique<layers_tuple_t>();
+    }
+    auto batches = std::vector<batch>(n_parts);
+    auto pool = std::unique_ptr<thread_pool>{};
+    if (n_parts > 1U) {
+      pool = std::make_unique<thread_pool>(n_parts - 1U);
+    }
+
+    auto const gradient = [&](size_t const p) -> layers_tuple_t& {
+      return p == 0U ? sum_ : *gradients[p];
+    };
+    auto const train_part = [&](size_t const p) {
+      auto const from = p * BatchSize / n_parts;
+      auto const to = (p + 1U) * BatchSize / n_parts;
+      zero_out(gradient(p));
+      train_batch(gradient(p),
+                  std::span<Input const>{in}.subspan(from, to - from),
+                  std::span<output_t const>{expected}.subspan(from, to - from),
+                  -1, batches[p]);
+    };
+    // Runs f(0), ..., f(n - 1) with f(0) on the calling thread.
+    auto const parallel_for = [&](size_t const n, auto&& f) {
+      for (auto p = size_t{1U}; p < n; ++p) {
+        pool->submit([&, p]() { f(p); });
+      }
+      f(0U);
+      if (pool != nullptr) {
+        pool->wait();
+      }
+    };
+
     auto optimizer = Optimizer<layers_tuple_t>{};
     for (auto i = 0; i != outer_loop_size; i++) {
-      zero_out(sum_);
-      for (auto batch_idx = 0; batch_idx < BatchSize; ++batch_idx) {
-        copy_ = layers_;
-        train(sum_, in[batch_idx], expected[batch_idx], -1);
+      parallel_for(n_parts, train_part);
+      for (auto stride = size_t{1U}; stride < n_parts; stride *= 2U) {
+        auto const n_adds = (n_parts + stride - 1U) / (2U * stride);
+        parallel_for(n_adds, [&](size_t const k) {
+          add(gradient(2U * stride * k), gradient(2U * stride * k + stride));
+        });
       }
       divide_by_batch_size<BatchSize>(sum_);
       optimizer.update(sum_, layers_);
@@ -318,14 +573,169 @@ struct network {
     for (auto& s : std::get<0>(outs)) {
       s = scale_from_output(min_, max_, s);
     }
+    compute_outputs<0>(outs);
+
+    auto const deltas = backpropagate(outs, expected);
+    update_weights<number_of_layers - 1>(sum_layers, outs, deltas,
+                                         learning_rate);
+  }
+
+  // Same as train(sum_layers, in.to_dense(), ...), but the first layer
+  // forward pass and weight update only touch the active inputs' columns.
+  template <unsigned Capacity>
+  void train(layers_tuple_t& sum_layers,
+             sparse_input<InputSize, Capacity> const& in,
+             output_t const& expected, real_t const learning_rate) {
+    if (!is_sparse()) {
+      train(sum_layers, in.to_dense(), expected, learning_rate);
+      return;
+    }
+
+    auto const active_value = scale_from_output(min_, max_, 1.0);
+    auto outs = layer_outputs_t{};  // std::get<0>(outs) stays unused
+    std::get<1>(outs) = std::get<0>(layers_).estimate(in, active_value);
+    compute_outputs<1>(outs);
+
+    auto const deltas = backpropagate(outs, expected);
+    update_weights<number_of_layers - 1, 1>(sum_layers, outs, deltas,
+                                            learning_rate);
+    std::get<0>(sum_layers).update_weights(std::get<0>(deltas), in,
+                                           active_value, learning_rate);
+  }
+
+  // Same as train(sum_layers, in[s], expected[s], learning_rate) for all
+  // samples s, computed with matrix-matrix products over blocks of
+  // batch_block_size samples.
+  template <size_t BatchSize, typename Input>
+  void train_batch(layers_tuple_t& sum_layers,
+                   std::array<Input, BatchSize> const& in,
+                   std::array<output_t, BatchSize> const& expected,
+                   real_t const learning_rate, batch& b) {
+    train_batch(sum_layers, std::span<Input const>{in},
+                std::span<output_t const>{expected}, learning_rate, b);
+  }
+
+  template <typename Input>
+  void train_batch(layers_tuple_t& sum_layers, std::span<Input const> in,
+                   std::span<output_t const> expected,
+                   real_t const learning_rate, batch& b) {
+    assert(in.size() == expected.size());
+    constexpr auto const dense = std::is_same_v<Input, input_t>;
+    auto const sparse = !dense && is_sparse();
+    auto const active_value = scale_from_output(min_, max_, 1.0);
+
+    batch_transpose<number_of_layers - 1>(b, sparse);
+    for (auto s0 = size_t{0U}; s0 < in.size(); s0 += batch_block_size) {
+      auto const n = std::min(batch_block_size, in.size() - s0);
+      b.resize(n);
+
+      auto& first_layer_out = std::get<0>(b.outputs_);
+      if (sparse) {
+        if constexpr (!dense) {
+          for (auto s = 0U; s != n; ++s) {
+            first_layer_out[s] =
+                std::get<0>(layers_).estimate(in[s0 + s], active_value);
+          }
+        }
+      } else {
+        for (auto s = 0U; s != n; ++s) {
+          if constexpr (dense) {
+            b.input_[s] = in[s0 + s];
+          } else {
+            b.input_[s] = in[s0 + s].to_dense();
+          }
+          for (auto& x : b.input_[s]) {
+            x = scale_from_output(min_, max_, x);
+          }
+        }
+        std::get<0>(layers_).estimate(b.input_, first_layer_out,
+                                      std::get<0>(b.transposed_weights_));
+      }
+      batch_forward<1U>(b);
+
+      auto const& last_layer_out = std::get<number_of_layers - 1>(b.outputs_);
+      auto& last_layer_deltas = std::get<number_of_layers - 1>(b.deltas_);
+      for (auto s = 0U; s != n; ++s) {
+        for (auto i = 0U; i < last_layer_out[s].size(); ++i) {
+          auto const out = last_layer_out[s][i];
+          last_layer_deltas[s][i] =
+              -(scale_from_output(min_, max_, expected[s0 + s][i]) - out) *
+              activation_fn_d(out);
+        }
+      }
+      if constexpr (number_of_layers > 1U) {
+        batch_deltas<number_of_layers - 2>(b);
+      }
+
+      batch_update_weights<number_of_layers - 1>(sum_layers, b,
+                                                 learning_rate);
+      auto const& first_layer_deltas = std::get<0>(b.deltas_);
+      if (sparse) {
+        if constexpr (!dense) {
+          for (auto s = 0U; s != n; ++s) {
+            std::get<0>(sum_layers).update_weights(first_layer_deltas[s],
+                                                   in[s0 + s], active_value,
+                                                   learning_rate);
+          }
+        }
+      } else {
+        std::get<0>(sum_layers).update_weights(first_layer_deltas, b.input_,
+                                               learning_rate);
+      }
+    }
+  }
+
+  // Layers I, I - 1, ..., 0. A sparse first layer is not transposed.
+  template <size_t I>
+  void batch_transpose(batch& b, bool const sparse) const {
+    if (I != 0U || !sparse) {
+      std::get<I>(layers_).transpose(std::get<I>(b.transposed_weights_));
+    }
+    if constexpr (I != 0U) {
+      batch_transpose<I - 1>(b, sparse);
+    }
+  }
+
+  template <size_t I>
+  void batch_forward(batch& b) const {
+    if constexpr (I != number_of_layers) {
+      std::get<I>(layers_).estimate(std::get<I - 1>(b.outputs_),
+                                    std::get<I>(b.outputs_),
+                                    std::get<I>(b.transposed_weights_));
+      batch_forward<I + 1U>(b);
+    }
+  }
+
+  template <size_t I>
+  void batch_deltas(batch& b) const {
+    std::get<I>(layers_).deltas(std::get<I + 1>(layers_),
+                                std::get<I>(b.outputs_),
+                                std::get<I + 1>(b.deltas_),
+                                std::get<I>(b.deltas_));
+    if constexpr (I != 0U) {
+      batch_deltas<I - 1>(b);
+    }
+  }
 
+  // Layers I, I - 1, ..., 1. Layer 0 depends on the input type.
+  template <size_t I>
+  void batch_update_weights(layers_tuple_t& sum_layers, batch const& b,
+                            real_t const learning_rate) const {
+    if constexpr (I != 0U) {
+      std::get<I>(sum_layers).update_weights(std::get<I>(b.deltas_),
+                                             std::get<I - 1>(b.outputs_),
+                                             learning_rate);
+      batch_update_weights<I - 1>(sum_layers, b, learning_rate);
+    }
+  }
+
+  deltas_t backpropagate(layer_outputs_t const& outs,
+                         output_t const& expected) {
     auto scaled_expected = expected;
     for (auto& s : scaled_expected) {
       s = scale_from_output(min_, max_, s);
     }
 
-    compute_outputs<0>(outs);
-
     auto diff = output_t{};
     auto& last_layer_out = std::get<number_of_layers>(outs);
     for (auto i = 0U; i < last_layer_out.size(); ++i) {
@@ -337,8 +747,7 @@ struct network {
     auto& last_layer_deltas = std::get<number_of_layers - 1>(deltas);
     last_layer_deltas = last_layer.deltas(diff, last_layer_out);
     compute_deltas<number_of_layers - 2>(outs, deltas);
-    update_weights<number_of_layers - 1>(sum_layers, outs, deltas,
-                                         learning_rate);
+    return deltas;
   }
 
   void train(input_t const& in, output_t const& expected,
@@ -346,6 +755,12 @@ struct network {
     train(layers_, in, expected, learning_rate);
   }
 
+  template <unsigned Capacity>
+  void train(sparse_input<InputSize, Capacity> const& in,
+             output_t const& expected, real_t const learning_rate) {
+    train(layers_, in, expected, learning_rate);
+  }
+
   real_t min_, max_;
   layers_tuple_t layers_{}, copy_{}, sum_{};
 };
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cassert>
+#include <array>
+#include <tuple>
+#include <vector>
+
+#include "cista/bit_counting.h"
+
+#include "chessbot/bitboard.h"
+#include "chessbot/constants.h"
+#include "chessbot/move.h"
+#include "chessbot/nn.h"
+#include "chessbot/nn_chess.h"
+#include "chessbot/position.h"
+
+namespace chessbot {
+
+// Incrementally updated first layer of a network that takes
+// nn_input_from_position() as input.
+//
+// The input is relative to the side to move (own pieces first), so there
+// are two accumulators: one as if white was to move and one as if black
+// was. Each holds the first layer's pre-activations (net). A piece that
+// appears or disappears adds or subtracts its weight column in both.
+//
+// push(p, m) must be called with the position *before* p.make_move(m). It
+// copies the top of the stack and applies the changes of m. pop() after
+// unmake_move() only drops the top entry.
+template <typename Network>
+struct nn_accumulator {
+  static constexpr auto const layer_size = Network::layer_sizes[0];
+  using values_t = std::array<real_t, layer_size>;
+  using entry_t = std::array<values_t, 2>;  // by perspective
+
+  explicit nn_accumulator(Network const& nn,
+                          unsigned const max_plies = max_search_ply)
+      : nn_{nn}, columns_(input_size) {
+    // estimate() scales every input x to (x - min) / (max - min): the
+    // constant part of an empty board goes into base_, active features
+    // add their column scaled by 1 / (max - min).
+    auto const& l = std::get<0>(nn.layers_);
+    auto const scale = 1.0 / (nn.max_ - nn.min_);
+    auto const offset = scale_from_output(nn.min_, nn.max_, 0.0);
+    for (auto i = 0U; i != layer_size; ++i) {
+      base_[i] = l.bias_weight_[i];
+      for (auto j = 0U; j != input_size; ++j) {
+        base_[i] += offset * l.weights_[i][j];
+        columns_[j][i] = scale * l.weights_[i][j];
+      }
+    }
+    stack_.reserve(max_plies + 1U);
+  }
+
+  void reset(position const& p) {
+    stack_.clear();
+    auto& e = stack_.emplace_back();
+    e[color::WHITE] = base_;
+    e[color::BLACK] = base_;
+    for (auto const c : {color::WHITE, color::BLACK}) {
+      for (auto pt = 0U; pt != NUM_PIECE_TYPES; ++pt) {
+        for_each_set_bit(p.pieces(c, piece_type(pt)), [&](bitboard const bb) {
+          add(e, c, piece_type(pt), bb);
+        });
+      }
+    }
+  }
+
+  void push(position const& p, move const m) {
+    assert(!stack_.empty() && stack_.size() < stack_.capacity());
+    stack_.emplace_back(stack_.back());
+    auto& e = stack_.back();
+
+    auto const us = p.to_move_;
+    auto const them = p.opposing_color();
+    auto const from = m.from();
+    auto const to = m.to();
+
+    if (m.special_move_ == special_move::CASTLE) {
+      auto const first_rank = us == color::WHITE ? R1 : R8;
+      auto const is_long = to == rank_file_to_bitboard(first_rank, FA);
+      sub(e, us, KING, from);
+      sub(e, us, ROOK, to);
+      add(e, us, KING, rank_file_to_bitboard(first_rank, is_long ? FC : FG));
+      add(e, us, ROOK, rank_file_to_bitboard(first_rank, is_long ? FD : FF));
+      return;
+    }
+
+    auto const pt = p.piece_on(from);
+    if ((to & p.pieces_by_color_[them]) != 0U) {
+      sub(e, them, p.piece_on(to), to);
+    } else if (pt == PAWN && to == p.en_passant_) {
+      sub(e, them, PAWN, us == color::WHITE ? to << 8U : to >> 8U);
+    }
+
+    sub(e, us, pt, from);
+    add(e, us,
+        m.special_move_ == special_move::PROMOTION
+            ? piece_type(static_cast<unsigned>(m.promotion_piece_type_) + 1U)
+            : pt,
+        to);
+  }
+
+  void pop() {
+    assert(stack_.size() > 1U);
+    stack_.pop_back();
+  }
+
+  // First layer pre-activations for the side to move.
+  values_t const& net(color const to_move) const {
+    return stack_.back()[to_move];
+  }
+
+  // Same result as nn.estimate(nn_input_from_position(p)) where p is the
+  // current position, up to rounding.
+  typename Network::output_t estimate(color const to_move) const {
+    auto out = net(to_move);
+    for (auto& x : out) {
+      x = activation_fn(x);
+    }
+    auto result = nn_.template forward<1U>(out);
+    for (auto& r : result) {
+      r = scale_to_output(nn_.min_, nn_.max_, r);
+    }
+    return result;
+  }
+
+private:
+  // Feature index of a piece from the given perspective (own pieces first).
+  static unsigned feature(color const perspective, color const c,
+                          piece_type const pt, bitboard const square) {
+    return (perspective == c ? 0U : 6U * 64U) + pt * 64U +
+           static_cast<unsigned>(cista::trailing_zeros(square));
+  }
+
+  void add(entry_t& e, color const c, piece_type const pt,
+           bitboard const square) {
+    for (auto const perspective : {color::WHITE, color::BLACK}) {
+      auto const& column = columns_[feature(perspective, c, pt, square)];
+      auto& v = e[perspective];
+      for (auto i = 0U; i != layer_size; ++i) {
+        v[i] += column[i];
+      }
+    }
+  }
+
+  void sub(entry_t& e, color const c, piece_type const pt,
+           bitboard const square) {
+    for (auto const perspective : {color::WHITE, color::BLACK}) {
+      auto const& column = columns_[feature(perspective, c, pt, square)];
+      auto& v = e[perspective];
+      for (auto i = 0U; i != layer_size; ++i) {
+        v[i] -= column[i];
+      }
+    }
+  }
+
+  Network const& nn_;
+  values_t base_{};
+  std::vector<values_t> columns_;  // columns_[feature][neuron]
+  std::vector<entry_t> stack_;
+};
+
+}  // namespace chessbot
@@ -43,6 +43,24 @@ inline std::array<real_t, input_size> nn_input_from_position(
   return input;
 }
 
+// At most 32 pieces on the board.
+using nn_sparse_input_t = sparse_input<input_size, 32U>;
+
+// Active features of nn_input_from_position(p).
+inline nn_sparse_input_t nn_sparse_input_from_position(position const& p) {
+  auto input = nn_sparse_input_t{};
+  auto offset = 0U;
+  for (auto const c : {p.to_move_, p.opposing_color()}) {
+    for (auto i = 0; i < NUM_PIECE_TYPES; ++i, offset += 64) {
+      for_each_set_bit(p.piece_states_[i] & p.pieces_by_color_[c],
+                       [&](bitboard const bb) {
+                         input.push_back(offset + cista::trailing_zeros(bb));
+                       });
+    }
+  }
+  return input;
+}
+
 inline std::array<real_t, output_size> to_expected(
     std::map<std::string, move_eval> const& evals) {
   auto expected = std::array<real_t, output_size>{};
@@ -68,7 +86,7 @@ void print_move_evals_sorted_by_error(
   }
   auto nn_out = std::array<std::array<real_t, output_size>, TestSetSize>{};
   for (auto const& [i, fen] : utl::enumerate(fens)) {
-    auto const p = position::from_fen(fen);
+    auto const p = position::parse_fen(fen);
     nn_out[i] = nn.estimate(nn_input_from_position(p));
   }
   auto const sort_moves_by_error = [&](auto const it) {
@@ -147,4 +165,26 @@ inline std::pair<real_t, real_t> determine_error(Network const& n,
   return error;
 }
 
+// Mean and max absolute difference of the outputs of two networks, e.g.
+// a network and its quantized copy.
+template <typename Input, typename NetworkA, typename NetworkB>
+inline std::pair<real_t, real_t> output_difference(NetworkA const& a,
+                                                   NetworkB const& b,
+                                                   Input const& input) {
+  auto diff = std::pair<real_t, real_t>{};
+  auto& [mean, max] = diff;
+  auto n = 0U;
+  for (auto const& in : input) {
+    auto const out_a = a.estimate(in);
+    auto const out_b = b.estimate(in);
+    for (auto i = 0U; i != out_a.size(); ++i, ++n) {
+      auto const d = std::abs(out_a[i] - out_b[i]);
+      mean += d;
+      max = std::max(max, d);
+    }
+  }
+  mean /= std::max(n, 1U);
+  return diff;
+}
+
 }  // namespace chessbot
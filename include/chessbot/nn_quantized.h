@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cinttypes>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "chessbot/nn.h"
+#include "chessbot/nn_simd.h"
+
+namespace chessbot {
+
+constexpr unsigned round_up(unsigned const n, unsigned const multiple) {
+  return (n + multiple - 1U) / multiple * multiple;
+}
+
+// Inference-only integer copy of a trained network with sparse one-hot
+// input (see sparse_input).
+//
+// First layer: int16 weight columns, summed for the active inputs. Input
+// scaling to [min, max] is folded into columns and bias as in
+// nn_accumulator. The scale is chosen so that MaxActive columns plus the
+// bias cannot overflow int16.
+//
+// Other layers: int8 weights (per layer scale 127 / max |w|) and int32
+// accumulation. Activations are sigmoid outputs quantized to [0, 127].
+//
+// Layer widths are padded to multiples of 16 with zero weights.
+template <typename Network, unsigned MaxActive = 32U>
+struct quantized_network {
+  static constexpr auto const input_size = Network::get_input_size(0U);
+  static constexpr auto const number_of_layers = Network::number_of_layers;
+  using input_t = sparse_input<input_size, MaxActive>;
+  using output_t = typename Network::output_t;
+
+  static constexpr auto const activation_scale = 127;
+
+  // sigmoid(x) for x in [-lut_range, lut_range] in steps of 1 / lut_steps.
+  static constexpr auto const lut_range = 16;
+  static constexpr auto const lut_steps = 128;
+  static constexpr auto const lut_size = 2U * lut_range * lut_steps + 1U;
+
+  struct first_layer {
+    static constexpr auto const layer_size = Network::layer_sizes[0];
+    static constexpr auto const padded_size = round_up(layer_size, 16U);
+
+    alignas(32) std::array<int16_t, input_size * padded_size> columns_{};
+    alignas(32) std::array<int16_t, padded_size> bias_{};
+    int64_t index_scale_{0};
+  };
+
+  template <unsigned InputSize, unsigned LayerSize>
+  struct hidden_layer {
+    static constexpr auto const layer_size = LayerSize;
+    static constexpr auto const padded_input_size = round_up(InputSize, 16U);
+    static constexpr auto const padded_size = round_up(LayerSize, 16U);
+
+    alignas(32) std::array<int8_t, padded_size * padded_input_size> weights_{};
+    alignas(32) std::array<int32_t, padded_size> bias_{};
+    int64_t index_scale_{0};
+  };
+
+  template <std::size_t... Is>
+  static constexpr auto get_type_helper(std::index_sequence<Is...>) {
+    return std::tuple<hidden_layer<Network::layer_sizes[Is],
+                                   Network::layer_sizes[Is + 1U]>...>{};
+  }
+
+  using layers_tuple_t = decltype(get_type_helper(
+      std::make_index_sequence<number_of_layers - 1U>{}));
+
+  explicit quantized_network(Network const& nn)
+      : min_{nn.min_}, max_{nn.max_} {
+    for (auto i = 0U; i != lut_size; ++i) {
+      auto const x = static_cast<real_t>(static_cast<int>(i) -
+                                         lut_range * lut_steps) /
+                     lut_steps;
+      output_lut_[i] = scale_to_output(nn.min_, nn.max_, activation_fn(x));
+      activation_lut_[i] = static_cast<uint8_t>(
+          std::lround(activation_scale * activation_fn(x)));
+    }
+    quantize_first(std::get<0>(nn.layers_), nn.min_, nn.max_);
+    quantize_hidden<1U>(nn);
+  }
+
+  // Approximates nn.estimate(in.to_dense()).
+  output_t estimate(input_t const& in) const {
+    constexpr auto const n = first_layer::padded_size;
+    alignas(32) auto acc = std::array<int16_t, n>{};
+    sum_columns_i16(acc.data(), first_.bias_.data(), first_.columns_.data(),
+                    in.indices_.data(), in.size_, n);
+    if constexpr (number_of_layers == 1U) {
+      return output(acc, first_.index_scale_);
+    } else {
+      return forward<1U>(activate<first_layer::layer_size>(
+          acc, first_.index_scale_));
+    }
+  }
+
+  real_t min_, max_;
+  first_layer first_;
+  layers_tuple_t layers_;
+  std::array<real_t, lut_size> output_lut_;  // scaled to [min_, max_]
+  std::array<uint8_t, lut_size> activation_lut_;
+
+private:
+  // LUT index of acc * dequantize with index_scale = 2^32 * lut_steps *
+  // dequantize. Integer only, so the loops vectorize.
+  static int64_t lut_index(int32_t const acc, int64_t const index_scale) {
+    auto const i = ((acc * index_scale + (int64_t{1} << 31U)) >> 32U) +
+                   lut_range * lut_steps;
+    return std::clamp(i, int64_t{0}, int64_t{lut_size - 1U});
+  }
+
+  static int64_t index_scale(real_t const dequantize) {
+    return std::llround(dequantize * lut_steps * 4294967296.0);
+  }
+
+  template <unsigned LayerSize, typename Acc>
+  auto activate(Acc const& acc, int64_t const index_scale) const {
+    alignas(32) auto out = std::array<uint8_t, std::tuple_size_v<Acc>>{};
+    for (auto i = 0U; i != LayerSize; ++i) {
+      out[i] = activation_lut_[lut_index(acc[i], index_scale)];
+    }
+    return out;
+  }
+
+  template <typename Acc>
+  output_t output(Acc const& acc, int64_t const index_scale) const {
+    auto out = output_t{};
+    for (auto i = 0U; i != out.size(); ++i) {
+      out[i] = output_lut_[lut_index(acc[i], index_scale)];
+    }
+    return out;
+  }
+
+  template <size_t I, typename In>
+  output_t forward(In const& in) const {
+    auto const& l = std::get<I - 1U>(layers_);
+    using layer_t = std::decay_t<decltype(l)>;
+    alignas(32) auto acc = std::array<int32_t, layer_t::padded_size>{};
+    affine_i8(in.data(), l.weights_.data(), l.bias_.data(), acc.data(),
+              layer_t::padded_input_size, layer_t::padded_size);
+    if constexpr (I + 1U == number_of_layers) {
+      return output(acc, l.index_scale_);
+    } else {
+      return forward<I + 1U>(
+          activate<layer_t::layer_size>(acc, l.index_scale_));
+    }
+  }
+
+  template <typename Layer>
+  void quantize_first(Layer const& l, real_t const min, real_t const max) {
+    constexpr auto const layer_size = Layer::layer_size;
+    auto const column_scale = 1.0 / (max - min);
+    auto const offset = scale_from_output(min, max, 0.0);
+
+    // Largest possible |net| of each neuron: bias plus the MaxActive
+    // largest columns.
+    auto bias = std::array<real_t, layer_size>{};
+    auto max_net = real_t{0.0};
+    auto magnitudes = std::vector<real_t>(input_size);
+    for (auto i = 0U; i != layer_size; ++i) {
+      bias[i] = l.bias_weight_[i];
+      for (auto j = 0U; j != input_size; ++j) {
+        bias[i] += offset * l.weights_[i][j];
+        magnitudes[j] = std::abs(column_scale * l.weights_[i][j]);
+      }
+      auto const n_active = std::min<size_t>(MaxActive, input_size);
+      std::partial_sort(begin(magnitudes), begin(magnitudes) + n_active,
+                        end(magnitudes), std::greater<>{});
+      auto net = std::abs(bias[i]);
+      for (auto j = 0U; j != n_active; ++j) {
+        net += magnitudes[j];
+      }
+      max_net = std::max(max_net, net);
+    }
+
+    // Margin for rounding errors of the summed terms.
+    auto const scale = max_net == 0.0 ? 1.0 : 32000.0 / max_net;
+    for (auto i = 0U; i != layer_size; ++i) {
+      first_.bias_[i] = static_cast<int16_t>(std::lround(bias[i] * scale));
+      for (auto j = 0U; j != input_size; ++j) {
+        first_.columns_[j * first_layer::padded_size + i] =
+            static_cast<int16_t>(
+                std::lround(column_scale * l.weights_[i][j] * scale));
+      }
+    }
+    first_.index_scale_ = index_scale(1.0 / scale);
+  }
+
+  template <size_t I>
+  void quantize_hidden(Network const& nn) {
+    if constexpr (I != number_of_layers) {
+      auto const& l = std::get<I>(nn.layers_);
+      auto& q = std::get<I - 1U>(layers_);
+      using layer_t = std::decay_t<decltype(q)>;
+
+      auto max_weight = real_t{0.0};
+      for (auto const& row : l.weights_) {
+        for (auto const w : row) {
+          max_weight = std::max(max_weight, std::abs(w));
+        }
+      }
+      auto const scale = max_weight == 0.0 ? 1.0 : 127.0 / max_weight;
+      for (auto i = 0U; i != l.weights_.size(); ++i) {
+        for (auto j = 0U; j != l.weights_[i].size(); ++j) {
+          q.weights_[i * layer_t::padded_input_size + j] =
+              static_cast<int8_t>(std::clamp(
+                  std::lround(l.weights_[i][j] * scale), -127L, 127L));
+        }
+        q.bias_[i] = static_cast<int32_t>(
+            std::lround(l.bias_weight_[i] * scale * activation_scale));
+      }
+      q.index_scale_ = index_scale(1.0 / (scale * activation_scale));
+      quantize_hidden<I + 1U>(nn);
+    }
+  }
+};
+
+}  // namespace chessbot
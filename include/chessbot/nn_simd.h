@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace chessbot {
+
+// Integer kernels of the quantized network (nn_quantized.h). AVX2 and
+// SSSE3 variants are compiled with target attributes and selected at
+// runtime, SCALAR works everywhere.
+enum class simd_backend : uint8_t { SCALAR, SSSE3, AVX2 };
+
+extern simd_backend active_simd_backend;
+
+// Best backend the CPU supports.
+simd_backend default_simd_backend();
+
+char const* to_str(simd_backend);
+
+// out = bias + sum of columns[indices[k] * n] for k < n_indices.
+// n is a multiple of 16, all pointers are 32 byte aligned.
+void sum_columns_i16(int16_t* out, int16_t const* bias, int16_t const* columns,
+                     uint16_t const* indices, unsigned n_indices, unsigned n);
+
+// out[i] = bias[i] + sum_j in[j] * weights[i * n_in + j] for i < n_out.
+// Inputs must be in [0, 127] and weights in [-127, 127] (no saturation in
+// pmaddubsw). n_in is a multiple of 16, n_out a multiple of 8.
+void affine_i8(uint8_t const* in, int8_t const* weights, int32_t const* bias,
+               int32_t* out, unsigned n_in, unsigned n_out);
+
+}  // namespace chessbot
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "chessbot/perft_table.h"
+#include "chessbot/position.h"
+
+namespace chessbot {
+
+using divide_t = std::vector<std::pair<move, size_t>>;
+
+// Same result as dfs_rec<true>(p, 0U, max_depth, info) computed on a
+// work-stealing pool: root moves are split first, subtrees with at least
+// min_split_depth remaining plies are split further while workers are idle.
+// The divide (leaves per root move) is returned in move generation order.
+// The optional table is shared by all workers.
+size_t parallel_dfs(position const&, unsigned max_depth, state_info const*,
+                    unsigned n_threads, divide_t& divide,
+                    perft_table* table = nullptr,
+                    unsigned min_split_depth = 3U);
+
+}  // namespace chessbot
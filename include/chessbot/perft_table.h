@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cinttypes>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <vector>
+
+#include "chessbot/zobrist.h"
+
+namespace chessbot {
+
+// Fixed-size, always-replace hash table: (hash, remaining depth) -> leaves.
+// Entries are two relaxed atomics storing (hash ^ data, data). A torn write
+// by a concurrent writer fails the XOR check and is treated as a miss, so
+// no locks are required.
+struct perft_table {
+  struct entry {
+    std::atomic_uint64_t key_{0U}, data_{0U};
+  };
+
+  explicit perft_table(size_t const size_mb)
+      : entries_(std::bit_floor(
+            std::max(size_t{1U}, size_mb * 1024U * 1024U / sizeof(entry)))),
+        mask_{entries_.size() - 1U} {}
+
+  bool get(zobrist_t const hash, unsigned const depth, size_t& leaves) const {
+    auto const& e = entries_[hash & mask_];
+    auto const data = e.data_.load(std::memory_order_relaxed);
+    auto const key = e.key_.load(std::memory_order_relaxed);
+    if ((key ^ data) != hash || (data & 0xFFU) != depth) {
+      return false;
+    }
+    leaves = data >> 8U;
+    return true;
+  }
+
+  void set(zobrist_t const hash, unsigned const depth, size_t const leaves) {
+    auto& e = entries_[hash & mask_];
+    auto const data = (uint64_t{leaves} << 8U) | (depth & 0xFFU);
+    e.key_.store(hash ^ data, std::memory_order_relaxed);
+    e.data_.store(data, std::memory_order_relaxed);
+  }
+
+  std::vector<entry> entries_;
+  size_t mask_;
+};
+
+}  // namespace chessbot
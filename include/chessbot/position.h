@@ -9,6 +9,7 @@
 
 #include "chessbot/constants.h"
 #include "chessbot/move.h"
+#include "chessbot/psqt.h"
 #include "chessbot/pgn.h"
 #include "chessbot/util.h"
 #include "chessbot/zobrist.h"
@@ -52,7 +53,13 @@ struct state_info {
   castling_rights castling_rights_;
   uint8_t half_move_clock_{0U};
   zobrist_t prev_hash_{0U};
+  psq_score prev_psq_;
   state_info const* prev_state_info_{nullptr};
+
+  // Restored by position::unmake_move.
+  std::array<bitboard, 2> prev_checkers_{};
+  std::array<bitboard, 2> prev_blockers_for_king_{};
+  std::array<bitboard, 2> prev_pinners_{};
 };
 
 struct position {
@@ -60,15 +67,34 @@ struct position {
   friend std::istream& operator>>(std::istream&, position&);
   static position from_fen(std::string const&);
 
+  // Allocation-free FEN I/O. read_fen() parses into *this and returns the
+  // text following the FEN. The full validate() pass is optional.
+  static constexpr auto const max_fen_length = 128U;
+  static position parse_fen(std::string_view, bool full_check = false);
+  std::string_view read_fen(std::string_view, bool full_check = false);
+
   void print() const;
   state_info make_move(move, state_info const* prev_state);
+  void unmake_move(move, state_info const&);
+
+  // Passes the turn (for null move pruning). Must not be in check. The
+  // state's last_move_ is move{}.
+  state_info make_null_move(state_info const* prev_state);
+  void unmake_null_move(state_info const&);
+
   state_info make_pgn_move(game::move const&,
                            state_info const* const prev_state);
   void update_blockers_and_pinners(move, bitboard en_passant);
   std::string to_str() const;
   std::string to_fen() const;
+  // Writes a '\0'-terminated FEN (at most max_fen_length bytes) to buf.
+  // Returns a pointer to the terminator.
+  char* to_fen(char* buf, bool full_check = false) const;
   void print_trace(state_info const*) const;
   void validate() const;
+  // psq_ matches compute_psq(). Not part of validate() because positions
+  // built by setting bitboards directly have no psq_.
+  void validate_psq() const;
 
   color opposing_color() const {
     return to_move_ == color::WHITE ? color::BLACK : color::WHITE;
@@ -82,6 +108,15 @@ struct position {
     return piece_states_[pt] & pieces_by_color_[c];
   }
 
+  // NUM_PIECE_TYPES for an empty square.
+  piece_type piece_on(bitboard const square) const {
+    auto pt = 0U;
+    while (pt != NUM_PIECE_TYPES && (piece_states_[pt] & square) == 0U) {
+      ++pt;
+    }
+    return piece_type(pt);
+  }
+
   template <color Color, piece_type PieceType>
   bitboard pieces() const {
     return piece_states_[PieceType] & pieces_by_color_[Color];
@@ -96,6 +131,14 @@ struct position {
     assert(toggle >> square_idx == 1U);
     hash_ ^= zobrist_color_hashes[square_idx][c];
     hash_ ^= zobrist_piece_hashes[square_idx][pt];
+
+    // +1 if the piece was added, -1 if it was removed.
+    auto const sign =
+        static_cast<int>((piece_states_[pt] >> square_idx) & 1U) * 2 - 1;
+    auto const& d = psqt[c][pt][square_idx];
+    psq_.mg_ += sign * d.mg_;
+    psq_.eg_ += sign * d.eg_;
+    psq_.phase_ += sign * d.phase_;
   }
 
   template <color Color>
@@ -122,6 +165,7 @@ struct position {
   std::array<bitboard, 2> blockers_for_king_{};
   std::array<bitboard, 2> pinners_{};
   zobrist_t hash_{0U};
+  psq_score psq_;  // maintained by toggle_pieces like hash_
   bitboard en_passant_{0U};
   uint8_t half_move_clock_{0U};
   unsigned full_move_count_{0U};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include "chessbot/eval.h"
+#include "chessbot/position.h"
+#include "chessbot/search.h"
+
+namespace chessbot {
+
+// Safety margin on top of the captured piece for delta pruning.
+constexpr auto const delta_margin = score_t{200};
+
+// Searches captures and queen promotions until the position is quiet.
+// The side to move may stand pat on the static evaluation. Captures that
+// lose material (SEE < 0) or can't reach alpha even when winning the
+// captured piece plus delta_margin are skipped. In check, all evasions are
+// searched and mate scores -mate_score + ply.
+//
+// Fail-soft, side to move relative. Counts visited nodes; stops expanding
+// once nodes reaches max_nodes (0 = no limit). p is restored on return.
+score_t quiesce(position& p, score_t alpha, score_t beta, unsigned ply,
+                size_t& nodes, size_t max_nodes = 0U);
+
+// Full window quiescence score of p.
+score_t quiesce(position const& p);
+
+// Not in check, and resolving the captures changes the static evaluation
+// by at most margin. Useful to pick positions for training sets.
+bool is_quiet(position const& p, score_t margin = 0);
+
+}  // namespace chessbot
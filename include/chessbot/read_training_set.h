@@ -19,8 +19,7 @@ read_training_set(std::istream& in) {
       std::vector<std::pair<position, std::map<std::string, move_eval>>>{};
   while (std::getline(in, line)) {
     auto p = position{};
-    auto l = std::stringstream{line};
-    l >> p;
+    auto l = std::stringstream{std::string{p.read_fen(line)}};
     auto move = std::string{};
     auto eval = std::string{};
     auto moves = std::map<std::string, move_eval>{};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "chessbot/eval.h"
+#include "chessbot/history.h"
+#include "chessbot/move.h"
+#include "chessbot/move_picker.h"
+#include "chessbot/position.h"
+#include "chessbot/transposition_table.h"
+
+namespace chessbot {
+
+constexpr auto const infinite_score = score_t{32000};
+constexpr auto const mate_score = score_t{31000};
+
+// Scores above this are "mate in (mate_score - score) plies".
+constexpr auto const min_mate_score =
+    mate_score - static_cast<score_t>(max_search_ply);
+
+constexpr bool is_mate_score(score_t const s) {
+  return s >= min_mate_score || s <= -min_mate_score;
+}
+
+// Zero means "no limit". The first iteration always completes.
+struct search_limits {
+  unsigned max_depth_{0U};
+  size_t max_nodes_{0U};
+  std::chrono::milliseconds max_time_{0U};
+};
+
+// Selective search techniques, each can be switched off to measure it.
+struct search_options {
+  bool null_move_{true};
+  bool lmr_{true};  // late move reductions
+  bool futility_{true};  // futility and reverse futility pruning
+  bool razoring_{true};
+};
+
+struct search_result {
+  double nps() const { return nodes_ / (std::max(time_us_, 1LL) / 1E6); }
+
+  move best_move_{};
+  score_t score_{0};
+  unsigned depth_{0U};
+  std::vector<move> pv_;
+  size_t nodes_{0U};
+  long long time_us_{0};
+};
+
+// Iterative deepening principal variation search.
+//
+// Several searchers can share one transposition table (Lazy SMP): they
+// search the same root independently and profit from each other's table
+// entries. Helpers stop when the shared stop flag is set.
+struct searcher {
+  using iteration_callback_t = std::function<void(search_result const&)>;
+
+  searcher(position const&, state_info const* root_info,
+           transposition_table* tt = nullptr,
+           std::atomic_bool const* shared_stop = nullptr,
+           unsigned thread_idx = 0U, search_options const& = {});
+
+  // Called after every completed iteration.
+  search_result search(search_limits const&,
+                       iteration_callback_t const& on_iteration = {});
+
+private:
+  score_t pvs(score_t alpha, score_t beta, unsigned depth, unsigned ply);
+  score_t qsearch(score_t alpha, score_t beta, unsigned ply);
+  bool should_stop();
+  void update_pv(unsigned ply, move);
+  void update_quiet_stats(unsigned ply, unsigned depth, move,
+                          std::array<move, max_moves> const& tried,
+                          unsigned n_tried);
+
+  position p_;
+  history history_;
+  transposition_table* tt_;
+  std::atomic_bool const* shared_stop_;
+  unsigned thread_idx_;
+  search_options options_;
+
+  search_limits limits_;
+  std::chrono::steady_clock::time_point start_;
+  size_t nodes_{0U};
+  bool stop_{false};
+  unsigned completed_depth_{0U};
+
+  // Triangular PV table: pv_[ply] holds the PV from ply on.
+  std::array<std::array<move, max_search_ply>, max_search_ply> pv_{};
+  std::array<unsigned, max_search_ply> pv_length_{};
+  std::vector<move> prev_pv_;
+  move_ordering ordering_;
+};
+
+// Runs n_threads searchers sharing tt (Lazy SMP). Limits and the callback
+// apply to the main thread; the result's node count includes all threads.
+search_result search(position const&, state_info const* root_info,
+                     search_limits const&,
+                     searcher::iteration_callback_t const& on_iteration = {},
+                     transposition_table* tt = nullptr,
+                     unsigned n_threads = 1U,
+                     search_options const& = {});
+
+}  // namespace chessbot
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "chessbot/eval.h"
+#include "chessbot/move.h"
+#include "chessbot/position.h"
+
+namespace chessbot {
+
+// Static exchange evaluation: material outcome of the capture sequence on
+// the destination square of m when both sides always recapture with their
+// least valuable attacker and may stop when that is better for them.
+// Sliders uncovered by a capture (x-rays) join in. Pinned pieces don't
+// recapture while their pinner is on the board. Castling scores 0.
+score_t see(position const&, move);
+
+// see(p, m) >= threshold, with early exits.
+bool see_ge(position const&, move, score_t threshold);
+
+}  // namespace chessbot
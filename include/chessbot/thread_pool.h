@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chessbot {
+
+// Work-stealing thread pool.
+// Tasks submitted by a worker go to the back of its own queue and are taken
+// LIFO by the owner. Idle workers steal from the front of other queues
+// (oldest task = usually the largest amount of work).
+struct thread_pool {
+  using task_t = std::function<void()>;
+
+  explicit thread_pool(unsigned n_threads);
+  ~thread_pool();
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  void submit(task_t);
+
+  // Blocks until all tasks (including tasks submitted by tasks) are done.
+  void wait();
+
+  bool has_idle_workers() const { return idle_.load() != 0U; }
+  unsigned size() const { return static_cast<unsigned>(queues_.size()); }
+
+private:
+  struct queue {
+    std::mutex mutex_;
+    std::deque<task_t> tasks_;
+  };
+
+  void run(unsigned worker_idx);
+  bool pop(unsigned worker_idx, task_t&);
+
+  std::vector<std::unique_ptr<queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_, done_;
+  std::atomic_size_t queued_{0U}, pending_{0U};
+  std::atomic_uint idle_{0U};
+  std::atomic_uint next_queue_{0U};
+  bool stop_{false};
+};
+
+}  // namespace chessbot
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cinttypes>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <vector>
+
+#include "chessbot/move.h"
+#include "chessbot/zobrist.h"
+
+namespace chessbot {
+
+enum class bound : uint8_t { NONE, UPPER, LOWER, EXACT };
+
+struct tt_data {
+  move move_{};
+  int16_t score_{0};
+  uint8_t depth_{0U};
+  bound bound_{bound::NONE};
+};
+
+// Search transposition table shared by all search threads.
+//
+// Buckets of four 16 byte entries fill one cache line. Like perft_table,
+// an entry is two relaxed atomics (hash ^ data, data): a torn write fails
+// the key check on the next probe and reads as a miss, so no locks are
+// needed. data packs move (16 bits), score (16), depth (8), bound (2) and
+// the search generation (6) used to prefer replacing stale entries.
+struct transposition_table {
+  static constexpr auto const bucket_size = 4U;
+
+  struct entry {
+    std::atomic_uint64_t key_{0U}, data_{0U};
+  };
+
+  struct alignas(64) bucket {
+    std::array<entry, bucket_size> entries_;
+  };
+
+  explicit transposition_table(size_t const size_mb)
+      : buckets_(std::bit_floor(
+            std::max(size_t{1U}, size_mb * 1024U * 1024U / sizeof(bucket)))),
+        mask_{buckets_.size() - 1U} {}
+
+  bool probe(zobrist_t const hash, tt_data& out) const {
+    for (auto const& e : buckets_[hash & mask_].entries_) {
+      auto const data = e.data_.load(std::memory_order_relaxed);
+      auto const key = e.key_.load(std::memory_order_relaxed);
+      if (data != 0U && (key ^ data) == hash) {
+        out = unpack(data);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void store(zobrist_t const hash, move const m, int16_t const score,
+             unsigned const depth, bound const b) {
+    auto& entries = buckets_[hash & mask_].entries_;
+
+    // Same position: overwrite in place. Otherwise replace the entry with
+    // the lowest depth, counting entries of older searches as shallower.
+    auto replace = &entries[0];
+    auto replace_value = std::numeric_limits<int>::max();
+    auto prev_move = move{};
+    for (auto& e : entries) {
+      auto const data = e.data_.load(std::memory_order_relaxed);
+      auto const key = e.key_.load(std::memory_order_relaxed);
+      if (data != 0U && (key ^ data) == hash) {
+        replace = &e;
+        prev_move = unpack(data).move_;
+        break;
+      }
+      auto const value = static_cast<int>((data >> 32U) & 0xFFU) -
+                         8 * static_cast<int>(relative_age(data));
+      if (value < replace_value) {
+        replace = &e;
+        replace_value = value;
+      }
+    }
+
+    // Keep the known best move if this search didn't find one.
+    auto const data =
+        pack(m.is_initialized() ? m : prev_move, score, depth, b);
+    replace->data_.store(data, std::memory_order_relaxed);
+    replace->key_.store(hash ^ data, std::memory_order_relaxed);
+  }
+
+  // Call once per search so older entries get replaced first.
+  void new_search() { generation_ = (generation_ + 1U) & 0x3FU; }
+
+  void clear() {
+    for (auto& b : buckets_) {
+      for (auto& e : b.entries_) {
+        e.key_.store(0U, std::memory_order_relaxed);
+        e.data_.store(0U, std::memory_order_relaxed);
+      }
+    }
+    generation_ = 0U;
+  }
+
+  // Permille of sampled entries written by the current search.
+  unsigned hashfull() const {
+    auto const n = std::min(size_t{1000U}, buckets_.size());
+    auto used = 0U;
+    for (auto i = 0U; i != n; ++i) {
+      for (auto const& e : buckets_[i].entries_) {
+        auto const data = e.data_.load(std::memory_order_relaxed);
+        used += data != 0U && relative_age(data) == 0U ? 1U : 0U;
+      }
+    }
+    return static_cast<unsigned>(used * 1000U / (n * bucket_size));
+  }
+
+  size_t size() const { return buckets_.size() * bucket_size; }
+
+private:
+  uint64_t pack(move const m, int16_t const score, unsigned const depth,
+                bound const b) const {
+    auto const packed_move =
+        uint64_t{m.from_field_} | (uint64_t{m.to_field_} << 6U) |
+        (static_cast<uint64_t>(m.promotion_piece_type_) << 12U) |
+        (static_cast<uint64_t>(m.special_move_) << 14U);
+    return packed_move | (uint64_t{static_cast<uint16_t>(score)} << 16U) |
+           (uint64_t{std::min(depth, 255U)} << 32U) |
+           (static_cast<uint64_t>(b) << 40U) |
+           (uint64_t{generation_} << 42U);
+  }
+
+  static tt_data unpack(uint64_t const data) {
+    auto d = tt_data{};
+    d.move_.from_field_ = data & 0x3FU;
+    d.move_.to_field_ = (data >> 6U) & 0x3FU;
+    d.move_.promotion_piece_type_ =
+        static_cast<promotion_piece_type>((data >> 12U) & 0x3U);
+    d.move_.special_move_ = static_cast<special_move>((data >> 14U) & 0x3U);
+    d.score_ = static_cast<int16_t>(static_cast<uint16_t>(data >> 16U));
+    d.depth_ = static_cast<uint8_t>(data >> 32U);
+    d.bound_ = static_cast<bound>((data >> 40U) & 0x3U);
+    return d;
+  }
+
+  unsigned relative_age(uint64_t const data) const {
+    return (generation_ - static_cast<unsigned>(data >> 42U)) & 0x3FU;
+  }
+
+  std::vector<bucket> buckets_;
+  size_t mask_;
+  unsigned generation_{0U};
+};
+
+}  // namespace chessbot
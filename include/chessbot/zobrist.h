@@ -18,4 +18,7 @@ extern std::array<zobrist_t, 8> zobrist_en_passant_hashes;
 
 zobrist_t compute_hash(position const&);
 
+// Adds castling rights, side to move and en passant to a hash of the pieces.
+zobrist_t compute_state_hash(position const&, zobrist_t piece_hash);
+
 }  // namespace chessbot
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "chessbot/eval.h"
+
+#include "chessbot/bitboard.h"
+
+namespace chessbot {
+
+psq_score compute_psq(position const& p) {
+  auto psq = psq_score{};
+  for (auto const c : {color::WHITE, color::BLACK}) {
+    for (auto pt = 0U; pt != NUM_PIECE_TYPES; ++pt) {
+      for_each_set_bit(p.pieces(c, piece_type(pt)), [&](bitboard const bb) {
+        auto const& d = psqt[c][pt][cista::trailing_zeros(bb)];
+        psq.mg_ += d.mg_;
+        psq.eg_ += d.eg_;
+        psq.phase_ += d.phase_;
+      });
+    }
+  }
+  return psq;
+}
+
+}  // namespace chessbot
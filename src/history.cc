@@ -0,0 +1,41 @@
+#include "chessbot/history.h"
+
+#include <algorithm>
+
+namespace chessbot {
+
+history::history(position const& root, state_info const* const root_info,
+                 unsigned const max_plies)
+    : root_info_{root_info} {
+  // Positions before the last irreversible move can't repeat.
+  auto prefix = std::vector<zobrist_t>{};
+  for (auto s = root_info;
+       s != nullptr && prefix.size() < root.half_move_clock_;
+       s = s->prev_state_info_) {
+    prefix.emplace_back(s->prev_hash_);
+  }
+
+  hashes_.reserve(prefix.size() + max_plies);
+  hashes_.insert(end(hashes_), prefix.rbegin(), prefix.rend());
+  states_.reserve(max_plies);
+}
+
+history::history(history const& o) : root_info_{o.root_info_} {
+  hashes_.reserve(o.hashes_.capacity());
+  hashes_ = o.hashes_;
+  states_.reserve(o.states_.capacity());
+  states_ = o.states_;
+  for (auto i = 0U; i != states_.size(); ++i) {
+    states_[i].prev_state_info_ = i == 0U ? root_info_ : &states_[i - 1U];
+  }
+}
+
+history& history::operator=(history const& o) {
+  if (this != &o) {
+    auto copy = history{o};
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+}  // namespace chessbot
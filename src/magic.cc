@@ -1,5 +1,8 @@
 #include "chessbot/magic.h"
 
+#include <vector>
+
+#include "chessbot/cpu_features.h"
 #include "chessbot/generate_moves.h"
 #include "chessbot/util.h"
 
@@ -42,8 +45,8 @@ std::array<bitboard, 64> rook_attack_bbs = []() {
   return attacks;
 }();
 
-std::array<int8_t, magic_number_num_bits> get_set_bit_indices(bitboard bb) {
-  auto set_bit_indices = std::array<int8_t, magic_number_num_bits>{};
+std::array<int8_t, max_magic_bits> get_set_bit_indices(bitboard bb) {
+  auto set_bit_indices = std::array<int8_t, max_magic_bits>{};
   auto i = 0U;
   while (bb != 0U) {
     set_bit_indices[i] = cista::trailing_zeros(bb);
@@ -56,39 +59,14 @@ std::array<int8_t, magic_number_num_bits> get_set_bit_indices(bitboard bb) {
   return set_bit_indices;
 }
 
-bitboard guess_magic_number(unsigned square_idx, piece_type const pt) {
-  while (true) {
-    auto const magic_number = get_random_number();
-    auto hits = std::array<bool, 1 << magic_number_num_bits>{};
-    auto error = false;
-    for_all_permutations(pt == ROOK ? rook_attack_bbs[square_idx]
-                                    : bishop_attack_bbs[square_idx],
-                         [&](bitboard const occupancy_permutation) -> bool {
-                           auto const index = get_magic_index(
-                               occupancy_permutation, magic_number);
-                           auto& entry = hits[index];
-                           if (entry) {
-                             error = true;
-                             return true;
-                           } else {
-                             entry = true;
-                             return false;
-                           }
-                         });
-    if (!error) {
-      return magic_number;
-    }
-  }
-}
-
 void attack_direction(bitboard& attack, bitboard const square,
                       bitboard const occupancy, int const north,
                       int const west) {
-  for (auto i = 1; i != 8; ++i) {
-    auto const attack_square = safe_north_west(square, north * i, west * i);
-    if (attack_square == 0U) {
-      break;
-    }
+  auto const square_idx = static_cast<int>(cista::trailing_zeros(square));
+  for (auto rank = square_idx / 8 - north, file = square_idx % 8 - west;
+       rank >= 0 && rank < 8 && file >= 0 && file < 8;
+       rank -= north, file -= west) {
+    auto const attack_square = bitboard{1} << (rank * 8 + file);
     attack |= attack_square;
     if (attack_square & occupancy) {
       break;
@@ -115,55 +93,147 @@ bitboard bishop_attack_squares(bitboard const square,
   return attack;
 }
 
-std::array<uint64_t, 64U> bishop_square_magic_numbers = []() {
-  auto square_magic_numbers = std::array<uint64_t, 64U>{};
-  for (auto i = 0U; i < 64U; ++i) {
-    square_magic_numbers[i] = guess_magic_number(i, piece_type::BISHOP);
+bitboard attack_squares(piece_type const pt, bitboard const square,
+                        bitboard const occupancy) {
+  return pt == ROOK ? rook_attack_squares(square, occupancy)
+                    : bishop_attack_squares(square, occupancy);
+}
+
+// Searches a magic number that maps every occupancy of the mask to an index
+// with popcount(mask) bits. Collisions are allowed if the attacks are equal.
+uint64_t guess_magic_number(unsigned const square_idx, piece_type const pt,
+                            bitboard const mask) {
+  auto const shift = 64U - std::popcount(mask);
+  auto occupancies = std::vector<bitboard>{};
+  auto attacks = std::vector<bitboard>{};
+  for_all_permutations(mask, [&](bitboard const occupancy_permutation) {
+    occupancies.emplace_back(occupancy_permutation);
+    attacks.emplace_back(
+        attack_squares(pt, bitboard{1} << square_idx, occupancy_permutation));
+    return false;
+  });
+
+  auto used = std::vector<bitboard>(occupancies.size());
+  auto used_in_attempt = std::vector<unsigned>(occupancies.size());
+  for (auto attempt = 1U;; ++attempt) {
+    auto const magic_number =
+        get_random_number() & get_random_number() & get_random_number();
+    if (std::popcount((mask * magic_number) >> 56U) < 6) {
+      continue;
+    }
+
+    auto error = false;
+    for (auto i = 0U; i != occupancies.size() && !error; ++i) {
+      auto const index = (occupancies[i] * magic_number) >> shift;
+      if (used_in_attempt[index] != attempt) {
+        used_in_attempt[index] = attempt;
+        used[index] = attacks[i];
+      } else {
+        error = used[index] != attacks[i];
+      }
+    }
+    if (!error) {
+      return magic_number;
+    }
   }
-  return square_magic_numbers;
-}();
+}
+
+// Found with guess_magic_number.
+constexpr auto const rook_magic_numbers = std::array<uint64_t, 64U>{
+    0x5080028424F04002ULL, 0x0240021000402008ULL, 0xA08010000C802000ULL,
+    0x0480048088001002ULL, 0x5200080200201084ULL, 0x0280040001801200ULL,
+    0x0080010000800200ULL, 0x0100002081000042ULL, 0x0080802080004000ULL,
+    0x5821004001002080ULL, 0x0082001020420080ULL, 0x1505001005002088ULL,
+    0x0000800400800800ULL, 0x1080800400800200ULL, 0x0114000801040290ULL,
+    0x2102000108822044ULL, 0xC080044000200040ULL, 0x0240010020810040ULL,
+    0x9500888010002000ULL, 0x004A020010082040ULL, 0x0800818008001C00ULL,
+    0x0820808002000400ULL, 0x6080840008190A30ULL, 0x0120020014008061ULL,
+    0x0000400080208000ULL, 0x8000200080400080ULL, 0x0220004100102100ULL,
+    0x0110048080100801ULL, 0x0004100500080100ULL, 0x0091400801042010ULL,
+    0x1002020080800100ULL, 0x2480004600028C01ULL, 0x0000408001002100ULL,
+    0x0080200080804002ULL, 0x0010002401200800ULL, 0x4000080080801004ULL,
+    0x0308808801800400ULL, 0x1440040080800200ULL, 0x4E20800200800100ULL,
+    0x0004006402000081ULL, 0x1120400080208000ULL, 0x1080422010024004ULL,
+    0x0040100020008080ULL, 0x0112010811420020ULL, 0x4002000804220010ULL,
+    0x0104000200808004ULL, 0x8040010002008080ULL, 0x84000C3088420001ULL,
+    0x0010248043020E00ULL, 0x8008200040009080ULL, 0x0300200080100080ULL,
+    0x0000220A10010100ULL, 0x1080C80080040280ULL, 0x4804004100020040ULL,
+    0x0000081001020400ULL, 0x0400008044010200ULL, 0x2100800100201041ULL,
+    0x4444204004110081ULL, 0x6290400900200015ULL, 0x0020042100081001ULL,
+    0x8003000800104205ULL, 0x0021000A04000803ULL, 0x2C010002000400C1ULL,
+    0x8404E04021008402ULL};
 
-std::array<uint64_t, 64U> rook_square_magic_numbers = []() {
-  auto square_magic_numbers = std::array<uint64_t, 64U>{};
+constexpr auto const bishop_magic_numbers = std::array<uint64_t, 64U>{
+    0x0030461004118810ULL, 0x8802044C00820440ULL, 0x0030442990A00024ULL,
+    0x01A4052200000000ULL, 0x08011041010B0400ULL, 0xC482088208108100ULL,
+    0x0202080109083108ULL, 0x0000240402080302ULL, 0x621008029428061AULL,
+    0x0100021404148201ULL, 0x1100100102082100ULL, 0x2000045404804008ULL,
+    0x8012820210210000ULL, 0x0418882828080620ULL, 0x00201A0210048400ULL,
+    0x0000022404140400ULL, 0x0008001020011430ULL, 0x1443019802080610ULL,
+    0x4208020100440480ULL, 0x0008040402408800ULL, 0x0024008202A200A0ULL,
+    0x4001000610008400ULL, 0x8100400201100828ULL, 0x4008800308413004ULL,
+    0x0020048811508200ULL, 0x0810029208080100ULL, 0x0484010402080100ULL,
+    0x0034080030081010ULL, 0x8141020004008420ULL, 0xA008008024406020ULL,
+    0x0282028022541080ULL, 0x2081010000240910ULL, 0x1002122008122080ULL,
+    0x8000882100A44400ULL, 0x4000AD0102100400ULL, 0x84210401080C0100ULL,
+    0x0110020202022008ULL, 0x0020008281010800ULL, 0x08060404040912C0ULL,
+    0x016A022200102098ULL, 0x0B5421041031C000ULL, 0x18408411204808A2ULL,
+    0x0000311088027004ULL, 0x9016014200810804ULL, 0x4004010124000600ULL,
+    0x4040240444102180ULL, 0x2004240084202200ULL, 0x1010048304421109ULL,
+    0x0800460824413000ULL, 0x0001010082200030ULL, 0x000A204208044031ULL,
+    0x9185214084041112ULL, 0x0403201002021401ULL, 0x8001200410408002ULL,
+    0x2092109000808004ULL, 0x40100400A4104002ULL, 0x0020422C01084000ULL,
+    0x0085A21104010400ULL, 0x0008400021180800ULL, 0x011C002004840400ULL,
+    0x0C00400041450104ULL, 0x0001004508102101ULL, 0x0000201CD1084100ULL,
+    0x0232200842008520ULL};
+
+std::array<magic, 64U> init_magics(piece_type const pt, unsigned offset) {
+  auto magics = std::array<magic, 64U>{};
   for (auto i = 0U; i < 64U; ++i) {
-    square_magic_numbers[i] = guess_magic_number(i, piece_type::ROOK);
+    auto& m = magics[i];
+    m.mask_ = pt == ROOK ? rook_attack_bbs[i] : bishop_attack_bbs[i];
+    m.number_ = pt == ROOK ? rook_magic_numbers[i] : bishop_magic_numbers[i];
+    m.offset_ = offset;
+    m.shift_ = 64U - std::popcount(m.mask_);
+    offset += 1U << std::popcount(m.mask_);
   }
-  return square_magic_numbers;
-}();
+  return magics;
+}
 
-std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-    magic_bishop_attack_squares = []() {
-      std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-          magic_attack_squares;
-      for (auto i = 0U; i < 64; ++i) {
-        for_all_permutations(
-            bishop_attack_bbs[i], [&](bitboard const occupancy_permutation) {
-              auto const permutation_index = get_magic_index(
-                  occupancy_permutation, bishop_square_magic_numbers[i]);
-              magic_attack_squares[i][permutation_index] =
-                  bishop_attack_squares(bitboard{1} << i,
-                                        occupancy_permutation);
-              return false;
-            });
-      }
-      return magic_attack_squares;
-    }();
-
-std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-    magic_rook_attack_squares = []() {
-      std::array<std::array<bitboard, (1U << magic_number_num_bits)>, 64U>
-          magic_attack_squares;
-      for (auto i = 0U; i < 64; ++i) {
-        for_all_permutations(
-            rook_attack_bbs[i], [&](bitboard const occupancy_permutation) {
-              auto const permutation_index = get_magic_index(
-                  occupancy_permutation, rook_square_magic_numbers[i]);
-              magic_attack_squares[i][permutation_index] =
-                  rook_attack_squares(bitboard{1} << i, occupancy_permutation);
-              return false;
-            });
-      }
-      return magic_attack_squares;
-    }();
+std::array<magic, 64U> rook_magics = init_magics(ROOK, 0U);
+
+std::array<magic, 64U> bishop_magics =
+    init_magics(BISHOP, rook_magic_table_size);
+
+std::array<bitboard, rook_magic_table_size + bishop_magic_table_size>
+    magic_attack_squares;
+
+slider_backend default_slider_backend() {
+  return cpu_has_bmi2() ? slider_backend::PEXT : slider_backend::MAGIC;
+}
+
+slider_backend active_slider_backend = default_slider_backend();
+
+void build_magic_attack_table() {
+  for (auto const pt : {ROOK, BISHOP}) {
+    for (auto i = 0U; i < 64; ++i) {
+      auto const& m = pt == ROOK ? rook_magics[i] : bishop_magics[i];
+      for_all_permutations(m.mask_, [&](bitboard const occupancy_permutation) {
+        magic_attack_squares[get_slider_index(occupancy_permutation, m)] =
+            attack_squares(pt, bitboard{1} << i, occupancy_permutation);
+        return false;
+      });
+    }
+  }
+}
+
+auto const magic_attack_table_built = (build_magic_attack_table(), true);
+
+void set_slider_backend(slider_backend const backend) {
+  if (backend != active_slider_backend) {
+    active_slider_backend = backend;
+    build_magic_attack_table();
+  }
+}
 
 }  // namespace chessbot
\ No newline at end of file
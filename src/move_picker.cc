@@ -0,0 +1,157 @@
+#include "chessbot/move_picker.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/see.h"
+
+namespace chessbot {
+
+namespace {
+
+template <typename T>
+T* pick_best(T* const begin, T* const end) {
+  std::swap(*begin, *std::max_element(begin, end, [](T const& a, T const& b) {
+    return a.score_ < b.score_;
+  }));
+  return begin;
+}
+
+template <typename T>
+bool contains(T const* const begin, T const* const end, move const m) {
+  return std::any_of(begin, end, [&](T const& s) { return s.move_ == m; });
+}
+
+}  // namespace
+
+move_picker::move_picker(position const& p, move const hash_move,
+                         move_ordering const* const ordering,
+                         unsigned const ply, bool const captures_only)
+    : p_{p},
+      hash_move_{captures_only ? move{} : hash_move},
+      ordering_{ordering},
+      ply_{ply},
+      captures_only_{captures_only},
+      stage_{hash_move_.is_initialized() ? stage::HASH_MOVE
+                                         : stage::GENERATE_CAPTURES} {}
+
+void move_picker::generate_captures() {
+  if (captures_end_ != nullptr) {
+    return;
+  }
+  std::array<move, max_moves> move_list;
+  auto const end = generate_moves<gen_type::CAPTURES>(p_, &move_list[0]);
+  captures_end_ = &captures_[0];
+  for (auto it = &move_list[0]; it != end; ++it) {
+    *captures_end_++ = {*it, mvv_lva(p_, *it)};
+  }
+  bad_captures_begin_ = captures_end_;
+}
+
+void move_picker::generate_quiets() {
+  if (quiets_end_ != nullptr) {
+    return;
+  }
+  std::array<move, max_moves> move_list;
+  auto const end = generate_moves<gen_type::QUIETS>(p_, &move_list[0]);
+  quiets_end_ = &quiets_[0];
+  for (auto it = &move_list[0]; it != end; ++it) {
+    *quiets_end_++ = {
+        *it, ordering_ == nullptr ? 0 : ordering_->history(p_.to_move_, *it)};
+  }
+}
+
+bool move_picker::is_skipped(move const m) const {
+  return m == hash_move_ ||
+         (ordering_ != nullptr && (m == ordering_->killers_[ply_][0] ||
+                                   m == ordering_->killers_[ply_][1]));
+}
+
+move move_picker::next() {
+  switch (stage_) {
+    case stage::HASH_MOVE: {
+      // The hash move may come from another position (hash collision):
+      // only yield it if it was generated here.
+      stage_ = stage::GENERATE_CAPTURES;
+      if (is_quiet_move(p_, hash_move_)) {
+        generate_quiets();
+        if (contains(&quiets_[0], quiets_end_, hash_move_)) {
+          return hash_move_;
+        }
+      } else {
+        generate_captures();
+        if (contains(&captures_[0], captures_end_, hash_move_)) {
+          return hash_move_;
+        }
+      }
+      hash_move_ = move{};
+      [[fallthrough]];
+    }
+
+    case stage::GENERATE_CAPTURES:
+      generate_captures();
+      cur_ = &captures_[0];
+      stage_ = stage::GOOD_CAPTURES;
+      [[fallthrough]];
+
+    case stage::GOOD_CAPTURES:
+      while (cur_ != bad_captures_begin_) {
+        auto const best = pick_best(cur_, bad_captures_begin_);
+        if (best->move_ == hash_move_) {
+          ++cur_;
+        } else if (!see_ge(p_, best->move_, 0)) {
+          std::swap(*best, *--bad_captures_begin_);
+        } else {
+          return (cur_++)->move_;
+        }
+      }
+      if (captures_only_) {
+        stage_ = stage::DONE;
+        return move{};
+      }
+      stage_ = stage::GENERATE_QUIETS;
+      [[fallthrough]];
+
+    case stage::GENERATE_QUIETS:
+      generate_quiets();
+      stage_ = stage::KILLERS;
+      [[fallthrough]];
+
+    case stage::KILLERS:
+      while (ordering_ != nullptr && killer_idx_ != 2U) {
+        auto const killer = ordering_->killers_[ply_][killer_idx_++];
+        if (killer.is_initialized() && killer != hash_move_ &&
+            contains(&quiets_[0], quiets_end_, killer)) {
+          return killer;
+        }
+      }
+      cur_ = &quiets_[0];
+      stage_ = stage::QUIETS;
+      [[fallthrough]];
+
+    case stage::QUIETS:
+      while (cur_ != quiets_end_) {
+        auto const m = pick_best(cur_, quiets_end_)->move_;
+        ++cur_;
+        if (!is_skipped(m)) {
+          return m;
+        }
+      }
+      cur_ = bad_captures_begin_;
+      stage_ = stage::BAD_CAPTURES;
+      [[fallthrough]];
+
+    case stage::BAD_CAPTURES:
+      if (cur_ != captures_end_) {
+        return (cur_++)->move_;
+      }
+      stage_ = stage::DONE;
+      [[fallthrough]];
+
+    case stage::DONE: return move{};
+  }
+  return move{};
+}
+
+}  // namespace chessbot
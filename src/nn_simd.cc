@@ -0,0 +1,198 @@
+#include "chessbot/nn_simd.h"
+
+#include "chessbot/cpu_features.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#define CHESSBOT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHESSBOT_TARGET(x) __attribute__((target(x)))
+#else
+#define CHESSBOT_TARGET(x)
+#endif
+
+namespace chessbot {
+
+simd_backend default_simd_backend() {
+  return cpu_has_avx2()    ? simd_backend::AVX2
+         : cpu_has_ssse3() ? simd_backend::SSSE3
+                           : simd_backend::SCALAR;
+}
+
+simd_backend active_simd_backend = default_simd_backend();
+
+char const* to_str(simd_backend const b) {
+  switch (b) {
+    case simd_backend::SCALAR: return "scalar";
+    case simd_backend::SSSE3: return "ssse3";
+    case simd_backend::AVX2: return "avx2";
+  }
+  return "";
+}
+
+namespace {
+
+void sum_columns_scalar(int16_t* out, int16_t const* bias,
+                        int16_t const* columns, uint16_t const* indices,
+                        unsigned const n_indices, unsigned const n) {
+  for (auto i = 0U; i != n; ++i) {
+    out[i] = bias[i];
+  }
+  for (auto k = 0U; k != n_indices; ++k) {
+    auto const column = columns + indices[k] * n;
+    for (auto i = 0U; i != n; ++i) {
+      out[i] = static_cast<int16_t>(out[i] + column[i]);
+    }
+  }
+}
+
+void affine_scalar(uint8_t const* in, int8_t const* weights,
+                   int32_t const* bias, int32_t* out, unsigned const n_in,
+                   unsigned const n_out) {
+  for (auto i = 0U; i != n_out; ++i) {
+    auto sum = bias[i];
+    auto const row = weights + i * n_in;
+    for (auto j = 0U; j != n_in; ++j) {
+      sum += static_cast<int32_t>(in[j]) * row[j];
+    }
+    out[i] = sum;
+  }
+}
+
+#if defined(CHESSBOT_X86)
+
+CHESSBOT_TARGET("ssse3")
+void sum_columns_ssse3(int16_t* out, int16_t const* bias,
+                       int16_t const* columns, uint16_t const* indices,
+                       unsigned const n_indices, unsigned const n) {
+  for (auto i = 0U; i != n; i += 8U) {
+    auto acc = _mm_load_si128(reinterpret_cast<__m128i const*>(bias + i));
+    for (auto k = 0U; k != n_indices; ++k) {
+      acc = _mm_add_epi16(acc, _mm_load_si128(reinterpret_cast<__m128i const*>(
+                                   columns + indices[k] * n + i)));
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(out + i), acc);
+  }
+}
+
+// Four rows at a time: pmaddubsw + pmaddwd give four int32 partial sums
+// per row, three phaddd reduce them to one int32 per row.
+CHESSBOT_TARGET("ssse3")
+void affine_ssse3(uint8_t const* in, int8_t const* weights,
+                  int32_t const* bias, int32_t* out, unsigned const n_in,
+                  unsigned const n_out) {
+  auto const ones = _mm_set1_epi16(1);
+  for (auto i = 0U; i != n_out; i += 4U) {
+    __m128i sums[4];
+    for (auto r = 0U; r != 4U; ++r) {
+      sums[r] = _mm_setzero_si128();
+    }
+    for (auto j = 0U; j != n_in; j += 16U) {
+      auto const x =
+          _mm_load_si128(reinterpret_cast<__m128i const*>(in + j));
+      for (auto r = 0U; r != 4U; ++r) {
+        auto const w = _mm_load_si128(
+            reinterpret_cast<__m128i const*>(weights + (i + r) * n_in + j));
+        sums[r] = _mm_add_epi32(
+            sums[r], _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+      }
+    }
+    auto const s = _mm_hadd_epi32(_mm_hadd_epi32(sums[0], sums[1]),
+                                  _mm_hadd_epi32(sums[2], sums[3]));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(out + i),
+        _mm_add_epi32(
+            s, _mm_loadu_si128(reinterpret_cast<__m128i const*>(bias + i))));
+  }
+}
+
+CHESSBOT_TARGET("avx2")
+void sum_columns_avx2(int16_t* out, int16_t const* bias,
+                      int16_t const* columns, uint16_t const* indices,
+                      unsigned const n_indices, unsigned const n) {
+  for (auto i = 0U; i != n; i += 16U) {
+    auto acc =
+        _mm256_load_si256(reinterpret_cast<__m256i const*>(bias + i));
+    for (auto k = 0U; k != n_indices; ++k) {
+      acc = _mm256_add_epi16(
+          acc, _mm256_load_si256(reinterpret_cast<__m256i const*>(
+                   columns + indices[k] * n + i)));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out + i), acc);
+  }
+}
+
+// Eight rows at a time. Each register holds 16 input bytes of two rows
+// (one per 128 bit lane), so n_in = 16 needs no padding. The phaddd
+// tree leaves rows in order 0 2 4 6 | 1 3 5 7, vpermd restores it.
+CHESSBOT_TARGET("avx2")
+void affine_avx2(uint8_t const* in, int8_t const* weights,
+                 int32_t const* bias, int32_t* out, unsigned const n_in,
+                 unsigned const n_out) {
+  auto const ones = _mm256_set1_epi16(1);
+  auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  for (auto i = 0U; i != n_out; i += 8U) {
+    __m256i sums[4];
+    for (auto r = 0U; r != 4U; ++r) {
+      sums[r] = _mm256_setzero_si256();
+    }
+    for (auto j = 0U; j != n_in; j += 16U) {
+      auto const x = _mm256_broadcastsi128_si256(
+          _mm_load_si128(reinterpret_cast<__m128i const*>(in + j)));
+      for (auto r = 0U; r != 4U; ++r) {
+        auto const row = weights + (i + 2U * r) * n_in + j;
+        auto const w = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_load_si128(reinterpret_cast<__m128i const*>(row))),
+            _mm_load_si128(reinterpret_cast<__m128i const*>(row + n_in)),
+            1);
+        sums[r] = _mm256_add_epi32(
+            sums[r], _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+      }
+    }
+    auto const s = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]),
+                                     _mm256_hadd_epi32(sums[2], sums[3]));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(out + i),
+        _mm256_add_epi32(
+            _mm256_permutevar8x32_epi32(s, order),
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(bias + i))));
+  }
+}
+
+#endif
+
+}  // namespace
+
+void sum_columns_i16(int16_t* out, int16_t const* bias, int16_t const* columns,
+                     uint16_t const* indices, unsigned const n_indices,
+                     unsigned const n) {
+  switch (active_simd_backend) {
+#if defined(CHESSBOT_X86)
+    case simd_backend::AVX2:
+      return sum_columns_avx2(out, bias, columns, indices, n_indices, n);
+    case simd_backend::SSSE3:
+      return sum_columns_ssse3(out, bias, columns, indices, n_indices, n);
+#endif
+    default:
+      return sum_columns_scalar(out, bias, columns, indices, n_indices, n);
+  }
+}
+
+void affine_i8(uint8_t const* in, int8_t const* weights, int32_t const* bias,
+               int32_t* out, unsigned const n_in, unsigned const n_out) {
+  switch (active_simd_backend) {
+#if defined(CHESSBOT_X86)
+    case simd_backend::AVX2:
+      return affine_avx2(in, weights, bias, out, n_in, n_out);
+    case simd_backend::SSSE3:
+      return affine_ssse3(in, weights, bias, out, n_in, n_out);
+#endif
+    default: return affine_scalar(in, weights, bias, out, n_in, n_out);
+  }
+}
+
+}  // namespace chessbot
@@ -0,0 +1,104 @@
+#include "chessbot/parallel_dfs.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "chessbot/dfs.h"
+#include "chessbot/generate_moves.h"
+#include "chessbot/history.h"
+#include "chessbot/thread_pool.h"
+
+namespace chessbot {
+
+namespace {
+
+struct perft_task {
+  // Copying the history relinks its states; the states before the root are
+  // shared and read-only.
+  position p_;
+  history history_;
+  unsigned depth_{0U};
+  unsigned root_move_idx_{0U};
+};
+
+struct parallel_perft {
+  void run(perft_task& t) {
+    if (max_depth_ - t.depth_ < min_split_depth_ ||
+        !pool_.has_idle_workers()) {
+      leaves_[t.root_move_idx_] +=
+          dfs_rec(t.p_, t.history_, t.depth_, max_depth_, table_);
+      return;
+    }
+
+    if (t.p_.half_move_clock_ == 100 ||
+        t.history_.count_repetitions(t.p_) >= 3U) {
+      leaves_[t.root_move_idx_] += 1U;
+      return;
+    }
+
+    std::array<move, max_moves> move_list;
+    auto const begin = &move_list[0];
+    auto const end = generate_moves(t.p_, begin);
+    for (auto it = begin; it != end; ++it) {
+      submit(t, *it);
+    }
+  }
+
+  void submit(perft_task const& parent, move const m) {
+    auto child = perft_task{parent.p_, parent.history_, parent.depth_ + 1U,
+                            parent.root_move_idx_};
+    child.history_.push(child.p_, m);
+    pool_.submit([this, child = std::move(child)]() mutable { run(child); });
+  }
+
+  thread_pool& pool_;
+  perft_table* table_;
+  unsigned max_depth_, min_split_depth_;
+  std::vector<std::atomic_size_t>& leaves_;
+};
+
+}  // namespace
+
+size_t parallel_dfs(position const& p, unsigned const max_depth,
+                    state_info const* const info, unsigned const n_threads,
+                    divide_t& divide, perft_table* const table,
+                    unsigned const min_split_depth) {
+  divide.clear();
+
+  if (p.half_move_clock_ == 100 || count_repetitions(p, info) >= 3U) {
+    return 1U;
+  }
+
+  std::array<move, max_moves> move_list;
+  auto const begin = &move_list[0];
+  auto const end = generate_moves(p, begin);
+  auto const n_moves = static_cast<unsigned>(end - begin);
+
+  if (max_depth == 1U) {
+    for (auto it = begin; it != end; ++it) {
+      divide.emplace_back(*it, 1U);
+    }
+    return n_moves;
+  }
+
+  auto leaves = std::vector<std::atomic_size_t>(n_moves);
+  {
+    auto pool = thread_pool{n_threads};
+    auto perft = parallel_perft{pool, table, max_depth,
+                                std::max(2U, min_split_depth), leaves};
+    auto const root_history = history{p, info, max_depth};
+    for (auto i = 0U; i != n_moves; ++i) {
+      perft.submit(perft_task{p, root_history, 0U, i}, begin[i]);
+    }
+    pool.wait();
+  }
+
+  auto total = size_t{0U};
+  for (auto i = 0U; i != n_moves; ++i) {
+    divide.emplace_back(begin[i], leaves[i].load());
+    total += leaves[i];
+  }
+  return total;
+}
+
+}  // namespace chessbot
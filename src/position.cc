@@ -1,5 +1,6 @@
 #include "chessbot/position.h"
 
+#include <algorithm>
 #include <istream>
 #include <ostream>
 #include <sstream>
@@ -9,6 +10,7 @@
 #include "utl/enumerate.h"
 #include "utl/verify.h"
 
+#include "chessbot/eval.h"
 #include "chessbot/generate_moves.h"
 #include "chessbot/util.h"
 
@@ -115,75 +117,230 @@ void position::validate() const {
   }
 }
 
+void position::validate_psq() const {
+  auto const psq = compute_psq(*this);
+  utl::verify(psq == psq_, "psq score mismatch: mg {} != {}, eg {} != {}",
+              psq_.mg_, psq.mg_, psq_.eg_, psq.eg_);
+}
+
+namespace {
+
+char* write_unsigned(char* out, unsigned n) {
+  auto digits = std::array<char, 10U>{};
+  auto n_digits = 0U;
+  do {
+    digits[n_digits++] = static_cast<char>('0' + n % 10U);
+    n /= 10U;
+  } while (n != 0U);
+  while (n_digits != 0U) {
+    *out++ = digits[--n_digits];
+  }
+  return out;
+}
+
+bool is_number(std::string_view const s) {
+  return !s.empty() && std::all_of(begin(s), end(s), [](char const c) {
+    return c >= '0' && c <= '9';
+  });
+}
+
+unsigned parse_unsigned(std::string_view const s) {
+  auto n = 0U;
+  for (auto const c : s) {
+    n = n * 10U + static_cast<unsigned>(c - '0');
+  }
+  return n;
+}
+
+}  // namespace
+
 position position::from_fen(std::string const& fen) {
-  auto ss = std::stringstream{fen};
+  return parse_fen(fen, true);
+}
+
+position position::parse_fen(std::string_view const fen,
+                             bool const full_check) {
   auto p = position{};
-  ss >> p;
+  p.read_fen(fen, full_check);
   return p;
 }
 
+std::string_view position::read_fen(std::string_view const fen,
+                                    bool const full_check) {
+  *this = position{};
+  castling_rights_.white_can_short_castle_ = false;
+  castling_rights_.white_can_long_castle_ = false;
+  castling_rights_.black_can_short_castle_ = false;
+  castling_rights_.black_can_long_castle_ = false;
+
+  auto pos = size_t{0U};
+  auto const next_field = [&]() {
+    while (pos != fen.size() && fen[pos] == ' ') {
+      ++pos;
+    }
+    auto const start = pos;
+    while (pos != fen.size() && fen[pos] != ' ') {
+      ++pos;
+    }
+    return fen.substr(start, pos - start);
+  };
+
+  auto rank = 0U, file = 0U;
+  for (auto const c : next_field()) {
+    if (c == '/') {
+      ++rank;
+      file = 0U;
+    } else if (c >= '1' && c <= '8') {
+      file += c - '0';
+    } else {
+      auto const is_white = c >= 'A' && c <= 'Z';
+      auto const index = (is_white ? white_pieces : black_pieces).find(c);
+      utl::verify(index != std::string_view::npos, "{} is not a valid piece",
+                  c);
+      utl::verify(rank < 8U && file < 8U, "piece {} outside of the board", c);
+      toggle_pieces(static_cast<piece_type>(index),
+                    is_white ? color::WHITE : color::BLACK,
+                    rank_file_to_bitboard(rank, file));
+      ++file;
+    }
+  }
+
+  auto const active_color = next_field();
+  utl::verify(active_color == "w" || active_color == "b",
+              "invalid color to move {}", active_color);
+  to_move_ = active_color == "w" ? color::WHITE : color::BLACK;
+
+  auto const castling = next_field();
+  utl::verify(!castling.empty(), "missing castling availability");
+  if (castling != "-") {
+    for (auto const c : castling) {
+      switch (c) {
+        case 'K': castling_rights_.white_can_short_castle_ = true; break;
+        case 'Q': castling_rights_.white_can_long_castle_ = true; break;
+        case 'k': castling_rights_.black_can_short_castle_ = true; break;
+        case 'q': castling_rights_.black_can_long_castle_ = true; break;
+        default: utl::verify(false, "invalid castling {}", c); break;
+      }
+    }
+  }
+
+  auto const en_passant = next_field();
+  if (en_passant != "-") {
+    utl::verify(en_passant.size() == 2U && en_passant[0] >= 'a' &&
+                    en_passant[0] <= 'h' && en_passant[1] >= '1' &&
+                    en_passant[1] <= '8',
+                "invalid en passant square {}", en_passant);
+    en_passant_ = rank_file_to_bitboard(8 - (en_passant[1] - '0'),
+                                        en_passant[0] - 'a');
+  }
+
+  // Half move clock and full move number are optional.
+  auto const before_counters = pos;
+  auto const half_move_clock = next_field();
+  if (is_number(half_move_clock)) {
+    half_move_clock_ = parse_unsigned(half_move_clock);
+    auto const before_full_move_count = pos;
+    auto const full_move_count = next_field();
+    if (is_number(full_move_count)) {
+      full_move_count_ = parse_unsigned(full_move_count);
+    } else {
+      pos = before_full_move_count;
+    }
+  } else {
+    pos = before_counters;
+  }
+
+  // toggle_pieces already hashed the pieces.
+  hash_ = compute_state_hash(*this, hash_);
+  if (std::popcount(piece_states_[KING]) == 2) {
+    init_blockers_and_pinners<true>(*this, color::WHITE);
+    init_blockers_and_pinners<true>(*this, color::BLACK);
+  }
+  if (full_check) {
+    validate();
+  }
+
+  return fen.substr(pos);
+}
+
 std::string position::to_fen() const {
-  validate();
+  auto buf = std::array<char, max_fen_length>{};
+  return {&buf[0], to_fen(&buf[0], true)};
+}
 
-  std::stringstream ss;
-  auto empty_square_count = 0U;
-  for (auto rank = 0U; rank != 8; ++rank) {
-    for (auto file = 0U; file != 8; ++file) {
-      auto empty = true;
+char* position::to_fen(char* out, bool const full_check) const {
+  if (full_check) {
+    validate();
+  }
+
+  auto const all = all_pieces();
+  for (auto rank = 0U; rank != 8U; ++rank) {
+    auto empty_square_count = 0U;
+    for (auto file = 0U; file != 8U; ++file) {
       auto const square_bb = rank_file_to_bitboard(rank, file);
-      for (auto const& [i, piece] : utl::enumerate(piece_states_)) {
-        if ((square_bb & piece) != 0U) {
-          if (empty_square_count != 0U) {
-            ss << empty_square_count;
-            empty_square_count = 0U;
-          }
-          ss << ((square_bb & pieces_by_color_[color::WHITE])
-                     ? white_pieces[i]
-                     : black_pieces[i % NUM_PIECE_TYPES]);
-          empty = false;
-        }
-      }
-      if (empty) {
+      if ((all & square_bb) == 0U) {
         ++empty_square_count;
+        continue;
+      }
+
+      if (empty_square_count != 0U) {
+        *out++ = static_cast<char>('0' + empty_square_count);
+        empty_square_count = 0U;
       }
+
+      auto pt = 0U;
+      while (pt != KING && (piece_states_[pt] & square_bb) == 0U) {
+        ++pt;
+      }
+      *out++ = (square_bb & pieces_by_color_[color::WHITE]) ? white_pieces[pt]
+                                                            : black_pieces[pt];
     }
 
     if (empty_square_count != 0U) {
-      ss << empty_square_count;
-      empty_square_count = 0U;
+      *out++ = static_cast<char>('0' + empty_square_count);
     }
 
     if (rank != 7U) {
-      ss << '/';
+      *out++ = '/';
     }
   }
 
-  ss << ' ' << (to_move_ == color::WHITE ? 'w' : 'b') << ' ';
+  *out++ = ' ';
+  *out++ = to_move_ == color::WHITE ? 'w' : 'b';
+  *out++ = ' ';
 
-  if (!castling_rights_.white_can_short_castle_ &&
-      !castling_rights_.white_can_long_castle_ &&
-      !castling_rights_.black_can_short_castle_ &&
-      !castling_rights_.black_can_long_castle_) {
-    ss << '-';
-  } else {
-    if (castling_rights_.white_can_short_castle_) {
-      ss << 'K';
-    }
-    if (castling_rights_.white_can_long_castle_) {
-      ss << 'Q';
-    }
-    if (castling_rights_.black_can_short_castle_) {
-      ss << 'k';
-    }
-    if (castling_rights_.black_can_long_castle_) {
-      ss << 'q';
-    }
+  auto const castling_start = out;
+  if (castling_rights_.white_can_short_castle_) {
+    *out++ = 'K';
+  }
+  if (castling_rights_.white_can_long_castle_) {
+    *out++ = 'Q';
+  }
+  if (castling_rights_.black_can_short_castle_) {
+    *out++ = 'k';
+  }
+  if (castling_rights_.black_can_long_castle_) {
+    *out++ = 'q';
+  }
+  if (out == castling_start) {
+    *out++ = '-';
   }
 
-  ss << ' ' << (en_passant_ == 0U ? "-" : get_square_name(en_passant_)) << ' '
-     << static_cast<unsigned>(half_move_clock_) << ' ' << full_move_count_;
+  *out++ = ' ';
+  if (en_passant_ == 0U) {
+    *out++ = '-';
+  } else {
+    auto const square_idx = cista::trailing_zeros(en_passant_);
+    *out++ = file_names[square_idx % 8U];
+    *out++ = rank_names[square_idx / 8U];
+  }
 
-  return ss.str();
+  *out++ = ' ';
+  out = write_unsigned(out, half_move_clock_);
+  *out++ = ' ';
+  out = write_unsigned(out, full_move_count_);
+  *out = '\0';
+  return out;
 }
 
 void position::print() const {
@@ -463,14 +620,19 @@ state_info position::make_move(move const m,
                                state_info const* const prev_state) {
 #ifndef NDEBUG
   validate();
+  validate_psq();
 #endif
 
   auto info = state_info{en_passant_,      m,     castling_rights_,
                          half_move_clock_, hash_, prev_state};
+  info.prev_checkers_ = checkers_;
+  info.prev_blockers_for_king_ = blockers_for_king_;
+  info.prev_pinners_ = pinners_;
+  info.prev_psq_ = psq_;
   ++half_move_clock_;
 
   if (en_passant_) {
-    hash_ ^= zobrist_en_passant_hashes[en_passant_ % 8];
+    hash_ ^= zobrist_en_passant_hashes[cista::trailing_zeros(en_passant_) % 8];
   }
   en_passant_ = bitboard{};
 
@@ -499,41 +661,60 @@ state_info position::make_move(move const m,
     }
 
     if (to_move_ == color::WHITE) {
+      if (castling_rights_.white_can_short_castle_) {
+        hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_SHORT];
+      }
+      if (castling_rights_.white_can_long_castle_) {
+        hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_LONG];
+      }
       castling_rights_.white_can_short_castle_ = false;
       castling_rights_.white_can_long_castle_ = false;
-      hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_SHORT];
-      hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_LONG];
     } else {
+      if (castling_rights_.black_can_short_castle_) {
+        hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_SHORT];
+      }
+      if (castling_rights_.black_can_long_castle_) {
+        hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_LONG];
+      }
       castling_rights_.black_can_short_castle_ = false;
       castling_rights_.black_can_long_castle_ = false;
-      hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_SHORT];
-      hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_LONG];
     }
   } else {
     auto pt = 0U;
-    for (auto& pieces : piece_states_) {
+    for (auto const pieces : piece_states_) {
       if (pieces & to) {
         info.captured_piece_ = static_cast<piece_type>(pt);
         half_move_clock_ = 0;
-        pieces ^= to;
-        pieces_by_color_[opposing_color()] ^= to;
+        toggle_pieces(info.captured_piece_, opposing_color(), to);
 
         switch (to) {
           case rank_file_to_bitboard(R1, FH):
-            hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_SHORT];
-            castling_rights_.white_can_short_castle_ = false;
+            if (castling_rights_.white_can_short_castle_) {
+              hash_ ^=
+                  zobrist_castling_right_hashes[castling_right::WHITE_SHORT];
+              castling_rights_.white_can_short_castle_ = false;
+            }
             break;
           case rank_file_to_bitboard(R8, FH):
-            hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_SHORT];
-            castling_rights_.black_can_short_castle_ = false;
+            if (castling_rights_.black_can_short_castle_) {
+              hash_ ^=
+                  zobrist_castling_right_hashes[castling_right::BLACK_SHORT];
+              castling_rights_.black_can_short_castle_ = false;
+            }
             break;
           case rank_file_to_bitboard(R1, FA):
-            hash_ ^= zobrist_castling_right_hashes[castling_right::WHITE_LONG];
-            castling_rights_.white_can_long_castle_ = false;
+            if (castling_rights_.white_can_long_castle_) {
+              hash_ ^=
+                  zobrist_castling_right_hashes[castling_right::WHITE_LONG];
+              castling_rights_.white_can_long_castle_ = false;
+            }
             break;
           case rank_file_to_bitboard(R8, FA):
-            hash_ ^= zobrist_castling_right_hashes[castling_right::BLACK_LONG];
-            castling_rights_.black_can_long_castle_ = false;
+            if (castling_rights_.black_can_long_castle_) {
+              hash_ ^=
+                  zobrist_castling_right_hashes[castling_right::BLACK_LONG];
+              castling_rights_.black_can_long_castle_ = false;
+            }
             break;
           default: break;
         }
@@ -658,6 +839,94 @@ state_info position::make_move(move const m,
   return info;
 }
 
+void position::unmake_move(move const m, state_info const& info) {
+  to_move_ = opposing_color();
+  if (to_move_ == BLACK) {
+    --full_move_count_;
+  }
+
+  // The hash and psq score are restored from info, so bitboards are
+  // toggled directly.
+  auto const toggle = [&](piece_type const pt, color const c,
+                          bitboard const bb) {
+    pieces_by_color_[c] ^= bb;
+    piece_states_[pt] ^= bb;
+  };
+
+  auto const from = m.from();
+  auto const to = m.to();
+  if (m.special_move_ == special_move::CASTLE) {
+    auto const first_rank = to_move_ == color::WHITE ? R1 : R8;
+    auto const is_long = to == rank_file_to_bitboard(first_rank, FA);
+    toggle(KING, to_move_,
+           from | rank_file_to_bitboard(first_rank, is_long ? FC : FG));
+    toggle(ROOK, to_move_,
+           to | rank_file_to_bitboard(first_rank, is_long ? FD : FF));
+  } else {
+    auto pt = 0U;
+    while ((piece_states_[pt] & to) == 0U) {
+      ++pt;
+    }
+    if (m.special_move_ == special_move::PROMOTION) {
+      toggle(static_cast<piece_type>(pt), to_move_, to);
+      toggle(PAWN, to_move_, from);
+    } else {
+      toggle(static_cast<piece_type>(pt), to_move_, from | to);
+    }
+
+    if (info.captured_piece_ != NUM_PIECE_TYPES) {
+      toggle(info.captured_piece_, opposing_color(), to);
+    } else if ((info.en_passant_ & to) && (from & piece_states_[PAWN])) {
+      toggle(PAWN, opposing_color(),
+             to_move_ == WHITE ? info.en_passant_ << bitboard{8}
+                               : info.en_passant_ >> bitboard{8});
+    }
+  }
+
+  en_passant_ = info.en_passant_;
+  castling_rights_ = info.castling_rights_;
+  half_move_clock_ = info.half_move_clock_;
+  hash_ = info.prev_hash_;
+  psq_ = info.prev_psq_;
+  checkers_ = info.prev_checkers_;
+  blockers_for_king_ = info.prev_blockers_for_king_;
+  pinners_ = info.prev_pinners_;
+
+#ifndef NDEBUG
+  validate();
+  validate_psq();
+#endif
+}
+
+state_info position::make_null_move(state_info const* const prev_state) {
+  assert(checkers_[to_move_] == 0U);
+
+  // Checkers, blockers and pinners don't change without a move.
+  auto info = state_info{en_passant_,      move{}, castling_rights_,
+                         half_move_clock_, hash_,  prev_state};
+  ++half_move_clock_;
+  if (en_passant_) {
+    hash_ ^= zobrist_en_passant_hashes[cista::trailing_zeros(en_passant_) % 8];
+    en_passant_ = bitboard{};
+  }
+  if (to_move_ == BLACK) {
+    ++full_move_count_;
+  }
+  to_move_ = opposing_color();
+  hash_ = ~hash_;
+  return info;
+}
+
+void position::unmake_null_move(state_info const& info) {
+  to_move_ = opposing_color();
+  if (to_move_ == BLACK) {
+    --full_move_count_;
+  }
+  en_passant_ = info.en_passant_;
+  half_move_clock_ = info.half_move_clock_;
+  hash_ = info.prev_hash_;
+}
+
 void position::update_blockers_and_pinners(move const m,
                                            bitboard const en_passant) {
   //  init_blockers_and_pinners<true>(*this, to_move_);
@@ -0,0 +1,75 @@
+#include "chessbot/quiescence.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "chessbot/move_picker.h"
+
+namespace chessbot {
+
+score_t quiesce(position& p, score_t alpha, score_t const beta,
+                unsigned const ply, size_t& nodes, size_t const max_nodes) {
+  if (max_nodes != 0U && nodes >= max_nodes) {
+    return static_eval(p);
+  }
+  ++nodes;
+  auto const in_check = p.checkers_[p.to_move_] != 0U;
+  if (ply + 1U >= max_search_ply) {
+    return static_eval(p);
+  }
+
+  auto stand_pat = -infinite_score;
+  if (!in_check) {
+    stand_pat = static_eval(p);
+    if (stand_pat >= beta) {
+      return stand_pat;
+    }
+    alpha = std::max(alpha, stand_pat);
+  }
+
+  // Out of check, the picker drops captures that lose material (SEE < 0).
+  auto best = stand_pat;
+  auto n_moves = 0U;
+  auto picker = move_picker{p, move{}, nullptr, ply, !in_check};
+  for (auto m = picker.next(); m.is_initialized(); m = picker.next()) {
+    ++n_moves;
+    if (!in_check &&
+        ((m.special_move_ == special_move::PROMOTION &&
+          m.promotion_piece_type_ != promotion_piece_type::QUEEN) ||
+         stand_pat + capture_value(p, m) + delta_margin <= alpha)) {
+      continue;
+    }
+
+    auto const state = p.make_move(m, nullptr);
+    auto const score = -quiesce(p, -beta, -alpha, ply + 1U, nodes, max_nodes);
+    p.unmake_move(m, state);
+
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        alpha = score;
+        if (alpha >= beta) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (in_check && n_moves == 0U) {
+    return -mate_score + static_cast<score_t>(ply);
+  }
+  return best;
+}
+
+score_t quiesce(position const& p) {
+  auto copy = p;
+  auto nodes = size_t{0U};
+  return quiesce(copy, -infinite_score, infinite_score, 0U, nodes);
+}
+
+bool is_quiet(position const& p, score_t const margin) {
+  return p.checkers_[p.to_move_] == 0U &&
+         std::abs(quiesce(p) - static_eval(p)) <= margin;
+}
+
+}  // namespace chessbot
@@ -0,0 +1,375 @@
+#include "chessbot/search.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/move_picker.h"
+#include "chessbot/quiescence.h"
+#include "chessbot/thread_pool.h"
+
+namespace chessbot {
+
+namespace {
+
+// Mate scores are stored relative to the node, not to the root.
+int16_t score_to_tt(score_t const s, unsigned const ply) {
+  auto const p = static_cast<score_t>(ply);
+  return static_cast<int16_t>(s >= min_mate_score    ? s + p
+                              : s <= -min_mate_score ? s - p
+                                                     : s);
+}
+
+score_t score_from_tt(int16_t const s, unsigned const ply) {
+  auto const p = static_cast<score_t>(ply);
+  return s >= min_mate_score ? s - p : s <= -min_mate_score ? s + p : s;
+}
+
+constexpr auto const futility_margin = score_t{150};
+constexpr auto const reverse_futility_margin = score_t{120};
+constexpr auto const razor_margin = score_t{300};
+
+score_t non_pawn_material(position const& p, color const c) {
+  auto material = score_t{0};
+  for (auto const pt : {KNIGHT, BISHOP, ROOK, QUEEN}) {
+    material += piece_values[pt] * std::popcount(p.pieces(c, pt));
+  }
+  return material;
+}
+
+// lmr_reductions[depth][move number]
+auto const lmr_reductions = []() {
+  auto table = std::array<std::array<unsigned, 64>, 64>{};
+  for (auto d = 1U; d != 64U; ++d) {
+    for (auto n = 1U; n != 64U; ++n) {
+      table[d][n] =
+          static_cast<unsigned>(0.75 + std::log(d) * std::log(n) / 2.25);
+    }
+  }
+  return table;
+}();
+
+}  // namespace
+
+searcher::searcher(position const& p, state_info const* const root_info,
+                   transposition_table* const tt,
+                   std::atomic_bool const* const shared_stop,
+                   unsigned const thread_idx, search_options const& options)
+    : p_{p},
+      history_{p, root_info, max_search_ply},
+      tt_{tt},
+      shared_stop_{shared_stop},
+      thread_idx_{thread_idx},
+      options_{options} {}
+
+bool searcher::should_stop() {
+  if (stop_) {
+    return true;
+  }
+  if (shared_stop_ != nullptr && thread_idx_ != 0U &&
+      shared_stop_->load(std::memory_order_relaxed)) {
+    return stop_ = true;
+  }
+  if (completed_depth_ == 0U) {
+    return false;
+  }
+  if (limits_.max_nodes_ != 0U && nodes_ >= limits_.max_nodes_) {
+    stop_ = true;
+  } else if (limits_.max_time_.count() != 0 && (nodes_ & 1023U) == 0U &&
+             std::chrono::steady_clock::now() - start_ >= limits_.max_time_) {
+    stop_ = true;
+  }
+  return stop_;
+}
+
+void searcher::update_pv(unsigned const ply, move const m) {
+  pv_[ply][ply] = m;
+  auto const child_length = pv_length_[ply + 1U];
+  std::copy(&pv_[ply + 1U][0] + ply + 1U, &pv_[ply + 1U][0] + child_length,
+            &pv_[ply][0] + ply + 1U);
+  pv_length_[ply] = child_length;
+}
+
+void searcher::update_quiet_stats(unsigned const ply, unsigned const depth,
+                                  move const m,
+                                  std::array<move, max_moves> const& tried,
+                                  unsigned const n_tried) {
+  auto const bonus = static_cast<int>(std::min(depth * depth, 400U));
+  ordering_.update_killers(ply, m);
+  ordering_.update_history(p_.to_move_, m, bonus);
+  for (auto i = 0U; i != n_tried; ++i) {
+    ordering_.update_history(p_.to_move_, tried[i], -bonus);
+  }
+}
+
+// The first iteration always completes.
+score_t searcher::qsearch(score_t const alpha, score_t const beta,
+                          unsigned const ply) {
+  return quiesce(p_, alpha, beta, ply, nodes_,
+                 completed_depth_ == 0U ? 0U : limits_.max_nodes_);
+}
+
+score_t searcher::pvs(score_t alpha, score_t const beta, unsigned const depth,
+                      unsigned const ply) {
+  pv_length_[ply] = ply;
+  if (should_stop()) {
+    return 0;
+  }
+
+  auto const is_draw = ply != 0U && (p_.half_move_clock_ >= 100U ||
+                                     history_.count_repetitions(p_) != 0U);
+  if (!is_draw && (depth == 0U || ply + 1U == max_search_ply)) {
+    return qsearch(alpha, beta, ply);  // counts the node
+  }
+
+  ++nodes_;
+  if (is_draw) {
+    return 0;
+  }
+
+  auto const is_pv = beta - alpha > 1;
+  auto tt_entry = tt_data{};
+  auto const tt_hit = tt_ != nullptr && tt_->probe(p_.hash_, tt_entry);
+  if (tt_hit && !is_pv && tt_entry.depth_ >= depth) {
+    auto const tt_score = score_from_tt(tt_entry.score_, ply);
+    if (tt_entry.bound_ == bound::EXACT ||
+        (tt_entry.bound_ == bound::LOWER && tt_score >= beta) ||
+        (tt_entry.bound_ == bound::UPPER && tt_score <= alpha)) {
+      return tt_score;
+    }
+  }
+
+  auto const in_check = p_.checkers_[p_.to_move_] != 0U;
+  auto const eval = in_check ? -infinite_score : static_eval(p_);
+  if (!is_pv && !in_check) {
+    // Reverse futility: far above beta, expect a quiet move to hold it.
+    if (options_.futility_ && depth <= 3U &&
+        eval - reverse_futility_margin * static_cast<score_t>(depth) >= beta &&
+        !is_mate_score(beta)) {
+      return eval;
+    }
+
+    // Razoring: far below alpha, only a capture can help.
+    if (options_.razoring_ && depth <= 2U &&
+        eval + razor_margin * static_cast<score_t>(depth) <= alpha) {
+      auto const score = qsearch(alpha, alpha + 1, ply);
+      if (score <= alpha) {
+        return score;
+      }
+    }
+
+    // Null move: if passing still fails high, a real move will too. Not
+    // with at most a minor piece left, where zugzwang is common, and never
+    // twice in a row.
+    if (options_.null_move_ && depth >= 3U && eval >= beta &&
+        non_pawn_material(p_, p_.to_move_) >= piece_values[ROOK] &&
+        (history_.empty() ||
+         history_.states_.back().last_move_.is_initialized())) {
+      auto const r = 2U + depth / 4U;
+      history_.push_null(p_);
+      auto const score =
+          -pvs(-beta, -beta + 1, depth > r + 1U ? depth - 1U - r : 0U,
+               ply + 1U);
+      history_.pop(p_);
+      if (stop_) {
+        return 0;
+      }
+      if (score >= beta) {
+        return is_mate_score(score) ? beta : score;
+      }
+    }
+  }
+
+  // The previous iteration's PV move takes precedence over the hash move.
+  auto hash_move = tt_hit ? tt_entry.move_ : move{};
+  auto const on_prev_pv =
+      ply < prev_pv_.size() &&
+      std::equal(history_.states_.begin(), history_.states_.end(),
+                 prev_pv_.begin(), [](state_info const& s, move const m) {
+                   return s.last_move_ == m;
+                 });
+  if (on_prev_pv) {
+    hash_move = prev_pv_[ply];
+  }
+
+  auto const original_alpha = alpha;
+  auto best = -infinite_score;
+  auto best_move = move{};
+  auto n_moves = 0U;
+  auto quiets_tried = std::array<move, max_moves>{};
+  auto n_quiets_tried = 0U;
+  auto picker = move_picker{p_, hash_move, &ordering_, ply};
+  for (auto m = picker.next(); m.is_initialized(); m = picker.next()) {
+    auto const quiet = is_quiet_move(p_, m);
+    auto const check = gives_check(p_, m);
+
+    // Futility: near the leaves, quiet moves can't lift a hopeless eval.
+    if (options_.futility_ && !is_pv && !in_check && depth <= 2U &&
+        n_moves != 0U && quiet && !check &&
+        eval + futility_margin * static_cast<score_t>(depth) <= alpha) {
+      continue;
+    }
+
+    history_.push(p_, m);
+    auto score = score_t{0};
+    if (n_moves == 0U) {
+      score = -pvs(-beta, -alpha, depth - 1U, ply + 1U);
+    } else {
+      // Late quiet moves are searched with reduced depth first.
+      auto r = 0U;
+      if (options_.lmr_ && depth >= 3U && n_moves >= 3U && quiet &&
+          !in_check && !check) {
+        r = lmr_reductions[std::min(depth, 63U)][std::min(n_moves, 63U)];
+        r = std::min(is_pv && r != 0U ? r - 1U : r, depth - 2U);
+      }
+      score = -pvs(-alpha - 1, -alpha, depth - 1U - r, ply + 1U);
+      if (r != 0U && score > alpha) {
+        score = -pvs(-alpha - 1, -alpha, depth - 1U, ply + 1U);
+      }
+      if (score > alpha && score < beta) {
+        score = -pvs(-beta, -alpha, depth - 1U, ply + 1U);
+      }
+    }
+    ++n_moves;
+    history_.pop(p_);
+
+    if (stop_) {
+      return 0;
+    }
+
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        alpha = score;
+        best_move = m;
+        update_pv(ply, m);
+        if (alpha >= beta) {
+          if (quiet) {
+            update_quiet_stats(ply, depth, m, quiets_tried, n_quiets_tried);
+          }
+          break;
+        }
+      }
+    }
+
+    if (quiet) {
+      quiets_tried[n_quiets_tried++] = m;
+    }
+  }
+
+  if (n_moves == 0U) {
+    return in_check ? -mate_score + static_cast<score_t>(ply) : 0;
+  }
+
+  if (tt_ != nullptr) {
+    auto const b = best >= beta             ? bound::LOWER
+                   : best > original_alpha ? bound::EXACT
+                                           : bound::UPPER;
+    tt_->store(p_.hash_, best_move, score_to_tt(best, ply), depth, b);
+  }
+
+  return best;
+}
+
+search_result searcher::search(search_limits const& limits,
+                               iteration_callback_t const& on_iteration) {
+  limits_ = limits;
+  start_ = std::chrono::steady_clock::now();
+  nodes_ = 0U;
+  stop_ = false;
+  completed_depth_ = 0U;
+  prev_pv_.clear();
+  ordering_.clear();
+
+  auto const elapsed_us = [&]() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start_)
+        .count();
+  };
+
+  auto const max_depth = limits.max_depth_ == 0U
+                             ? max_search_ply - 1U
+                             : std::min(limits.max_depth_, max_search_ply - 1U);
+  auto result = search_result{};
+
+  // Helpers with an odd index start one ply deeper to spread the threads
+  // over different depths.
+  for (auto depth = 1U + (thread_idx_ & 1U); depth <= max_depth; ++depth) {
+    auto const score = pvs(-infinite_score, infinite_score, depth, 0U);
+    if (stop_) {
+      break;
+    }
+
+    completed_depth_ = depth;
+    result.score_ = score;
+    result.depth_ = depth;
+    result.pv_.assign(&pv_[0][0], &pv_[0][0] + pv_length_[0]);
+    result.best_move_ = result.pv_.empty() ? move{} : result.pv_.front();
+    result.nodes_ = nodes_;
+    result.time_us_ = elapsed_us();
+    prev_pv_ = result.pv_;
+
+    if (on_iteration) {
+      on_iteration(result);
+    }
+
+    // A mate within the searched depth won't change.
+    if (result.pv_.empty() ||
+        (is_mate_score(score) &&
+         mate_score - std::abs(score) <= static_cast<score_t>(depth))) {
+      break;
+    }
+  }
+
+  result.nodes_ = nodes_;
+  result.time_us_ = elapsed_us();
+  return result;
+}
+
+search_result search(position const& p, state_info const* const root_info,
+                     search_limits const& limits,
+                     searcher::iteration_callback_t const& on_iteration,
+                     transposition_table* const tt, unsigned const n_threads,
+                     search_options const& options) {
+  if (tt != nullptr) {
+    tt->new_search();
+  }
+
+  auto stop = std::atomic_bool{false};
+  auto searchers = std::vector<std::unique_ptr<searcher>>{};
+  for (auto i = 0U; i != std::max(1U, n_threads); ++i) {
+    searchers.emplace_back(
+        std::make_unique<searcher>(p, root_info, tt, &stop, i, options));
+  }
+
+  auto helper_nodes = std::vector<size_t>(searchers.size());
+  auto result = search_result{};
+  {
+    auto pool = std::unique_ptr<thread_pool>{};
+    if (searchers.size() > 1U) {
+      pool = std::make_unique<thread_pool>(searchers.size() - 1U);
+      auto const helper_limits = search_limits{.max_depth_ = limits.max_depth_};
+      for (auto i = 1U; i != searchers.size(); ++i) {
+        pool->submit([&, i]() {
+          helper_nodes[i] = searchers[i]->search(helper_limits).nodes_;
+        });
+      }
+    }
+
+    result = searchers[0]->search(limits, on_iteration);
+    stop = true;
+    if (pool != nullptr) {
+      pool->wait();
+    }
+  }
+
+  for (auto const n : helper_nodes) {
+    result.nodes_ += n;
+  }
+  return result;
+}
+
+}  // namespace chessbot
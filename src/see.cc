@@ -0,0 +1,172 @@
+#include "chessbot/see.h"
+
+#include <algorithm>
+#include <array>
+
+#include "cista/bit_counting.h"
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/magic.h"
+
+namespace chessbot {
+
+namespace {
+
+// State of the capture sequence on one square. The pieces that already
+// captured are removed from occupied_; sliders behind them are added to
+// attackers_.
+struct exchange {
+  exchange(position const& p, move const m)
+      : p_{p},
+        to_{m.to()},
+        occupied_{p.all_pieces() ^ m.from()},
+        diagonal_sliders_{p.piece_states_[BISHOP] | p.piece_states_[QUEEN]},
+        straight_sliders_{p.piece_states_[ROOK] | p.piece_states_[QUEEN]} {
+    auto const mover = p.piece_on(m.from());
+    auto const captured = p.piece_on(to_);
+    captured_value_ = captured == NUM_PIECE_TYPES ? 0 : piece_values[captured];
+    on_square_value_ = piece_values[mover];
+
+    if (mover == PAWN && to_ == p.en_passant_) {
+      occupied_ ^= p.to_move_ == color::WHITE ? to_ << 8U : to_ >> 8U;
+      captured_value_ = piece_values[PAWN];
+    } else if (m.special_move_ == special_move::PROMOTION) {
+      auto const promoted =
+          piece_type(static_cast<unsigned>(m.promotion_piece_type_) + 1U);
+      captured_value_ += piece_values[promoted] - piece_values[PAWN];
+      on_square_value_ = piece_values[promoted];
+    }
+
+    auto const to_idx = cista::trailing_zeros(to_);
+    attackers_ =
+        ((pawn_attacks_bb(to_, color::BLACK) & p.pieces<color::WHITE, PAWN>()) |
+         (pawn_attacks_bb(to_, color::WHITE) & p.pieces<color::BLACK, PAWN>()) |
+         (knight_attacks_by_origin_square[to_idx] & p.piece_states_[KNIGHT]) |
+         (king_attacks_by_origin_square[to_idx] & p.piece_states_[KING]) |
+         (get_attack_squares<BISHOP>(to_, occupied_) & diagonal_sliders_) |
+         (get_attack_squares<ROOK>(to_, occupied_) & straight_sliders_)) &
+        occupied_;
+
+    pinned_[color::WHITE] = pinned_pieces<color::WHITE>(
+        p, cista::trailing_zeros(p.pieces<color::WHITE, KING>()));
+    pinned_[color::BLACK] = pinned_pieces<color::BLACK>(
+        p, cista::trailing_zeros(p.pieces<color::BLACK, KING>()));
+  }
+
+  // Attackers of color c that may capture next.
+  bitboard attackers(color const c) {
+    attackers_ &= occupied_;
+    auto a = attackers_ & p_.pieces_by_color_[c];
+    if ((p_.pinners_[c] & occupied_) != 0U) {
+      a &= ~pinned_[c];
+    }
+    return a;
+  }
+
+  piece_type least_valuable(bitboard const attackers) const {
+    auto pt = 0U;
+    while ((p_.piece_states_[pt] & attackers) == 0U) {
+      ++pt;
+    }
+    return piece_type(pt);
+  }
+
+  void capture_with(piece_type const pt, bitboard const attackers) {
+    auto const bb = attackers & p_.piece_states_[pt];
+    occupied_ ^= bb & (~bb + 1U);
+    if (pt == PAWN || pt == BISHOP || pt == QUEEN) {
+      attackers_ |= get_attack_squares<BISHOP>(to_, occupied_) &
+                    diagonal_sliders_;
+    }
+    if (pt == ROOK || pt == QUEEN) {
+      attackers_ |=
+          get_attack_squares<ROOK>(to_, occupied_) & straight_sliders_;
+    }
+  }
+
+  position const& p_;
+  bitboard to_, occupied_, attackers_;
+  bitboard diagonal_sliders_, straight_sliders_;
+  std::array<bitboard, 2> pinned_;
+  score_t captured_value_, on_square_value_;
+};
+
+}  // namespace
+
+score_t see(position const& p, move const m) {
+  if (m.special_move_ == special_move::CASTLE) {
+    return 0;
+  }
+
+  auto e = exchange{p, m};
+  auto gain = std::array<score_t, 33>{};
+  auto on_square_value = e.on_square_value_;
+  auto stm = p.to_move_;
+  auto d = 0U;
+  gain[0] = e.captured_value_;
+  while (true) {
+    stm = stm == color::WHITE ? color::BLACK : color::WHITE;
+    auto const attackers = e.attackers(stm);
+    if (attackers == 0U) {
+      break;
+    }
+
+    auto const pt = e.least_valuable(attackers);
+    if (pt == KING && (e.attackers_ & ~p.pieces_by_color_[stm]) != 0U) {
+      break;
+    }
+
+    ++d;
+    gain[d] = on_square_value - gain[d - 1U];
+    on_square_value = piece_values[pt];
+    e.capture_with(pt, attackers);
+  }
+
+  for (; d != 0U; --d) {
+    gain[d - 1U] = -std::max(-gain[d - 1U], gain[d]);
+  }
+  return gain[0];
+}
+
+bool see_ge(position const& p, move const m, score_t const threshold) {
+  if (m.special_move_ == special_move::CASTLE) {
+    return 0 >= threshold;
+  }
+
+  auto e = exchange{p, m};
+
+  // swap: what the side to move has to give back to end below threshold.
+  auto swap = e.captured_value_ - threshold;
+  if (swap < 0) {
+    return false;
+  }
+  swap = e.on_square_value_ - swap;
+  if (swap <= 0) {
+    return true;
+  }
+
+  auto stm = p.to_move_;
+  auto res = true;
+  while (true) {
+    stm = stm == color::WHITE ? color::BLACK : color::WHITE;
+    auto const attackers = e.attackers(stm);
+    if (attackers == 0U) {
+      break;
+    }
+
+    res = !res;
+    auto const pt = e.least_valuable(attackers);
+    if (pt == KING) {
+      return (e.attackers_ & ~p.pieces_by_color_[stm]) != 0U ? !res : res;
+    }
+
+    swap = piece_values[pt] - swap;
+    if (swap < static_cast<score_t>(res)) {
+      break;
+    }
+    e.capture_with(pt, attackers);
+  }
+  return res;
+}
+
+}  // namespace chessbot
@@ -0,0 +1,108 @@
+#include "chessbot/thread_pool.h"
+
+#include <algorithm>
+
+namespace chessbot {
+
+namespace {
+
+thread_local thread_pool const* current_pool = nullptr;
+thread_local unsigned current_worker_idx = 0U;
+
+}  // namespace
+
+thread_pool::thread_pool(unsigned const n_threads) {
+  auto const n = std::max(1U, n_threads);
+  for (auto i = 0U; i != n; ++i) {
+    queues_.emplace_back(std::make_unique<queue>());
+  }
+  for (auto i = 0U; i != n; ++i) {
+    workers_.emplace_back([this, i]() { run(i); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  wait();
+  {
+    auto const lock = std::lock_guard{mutex_};
+    stop_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& w : workers_) {
+    w.join();
+  }
+}
+
+void thread_pool::submit(task_t t) {
+  auto const queue_idx = current_pool == this
+                             ? current_worker_idx
+                             : next_queue_.fetch_add(1U) % size();
+  ++pending_;
+  {
+    auto const lock = std::lock_guard{mutex_};
+    auto& q = *queues_[queue_idx];
+    auto const queue_lock = std::lock_guard{q.mutex_};
+    q.tasks_.emplace_back(std::move(t));
+    ++queued_;
+  }
+  work_available_.notify_one();
+}
+
+void thread_pool::wait() {
+  auto lock = std::unique_lock{mutex_};
+  done_.wait(lock, [&]() { return pending_ == 0U; });
+}
+
+bool thread_pool::pop(unsigned const worker_idx, task_t& t) {
+  {
+    auto& own = *queues_[worker_idx];
+    auto const lock = std::lock_guard{own.mutex_};
+    if (!own.tasks_.empty()) {
+      t = std::move(own.tasks_.back());
+      own.tasks_.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+
+  for (auto i = 1U; i != size(); ++i) {
+    auto& victim = *queues_[(worker_idx + i) % size()];
+    auto const lock = std::lock_guard{victim.mutex_};
+    if (!victim.tasks_.empty()) {
+      t = std::move(victim.tasks_.front());
+      victim.tasks_.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void thread_pool::run(unsigned const worker_idx) {
+  current_pool = this;
+  current_worker_idx = worker_idx;
+
+  auto t = task_t{};
+  while (true) {
+    if (pop(worker_idx, t)) {
+      t();
+      t = nullptr;
+      if (pending_.fetch_sub(1U) == 1U) {
+        auto const lock = std::lock_guard{mutex_};
+        done_.notify_all();
+      }
+      continue;
+    }
+
+    auto lock = std::unique_lock{mutex_};
+    ++idle_;
+    work_available_.wait(lock, [&]() { return queued_ != 0U || stop_; });
+    --idle_;
+    if (stop_ && queued_ == 0U) {
+      return;
+    }
+  }
+}
+
+}  // namespace chessbot
@@ -59,6 +59,10 @@ zobrist_t compute_hash(position const& p) {
     });
   }
 
+  return compute_state_hash(p, hash);
+}
+
+zobrist_t compute_state_hash(position const& p, zobrist_t hash) {
   if (p.castling_rights_.white_can_short_castle_) {
     hash ^= zobrist_castling_right_hashes[castling_right::WHITE_SHORT];
   }
@@ -77,7 +81,8 @@ zobrist_t compute_hash(position const& p) {
   }
 
   if (p.en_passant_) {
-    hash ^= zobrist_en_passant_hashes[p.en_passant_ % 8];
+    hash ^=
+        zobrist_en_passant_hashes[cista::trailing_zeros(p.en_passant_) % 8];
   }
 
   return hash;
@@ -0,0 +1,63 @@
+#include "doctest/doctest.h"
+
+#include "chessbot/eval.h"
+#include "chessbot/generate_moves.h"
+#include "chessbot/position.h"
+
+using namespace chessbot;
+
+namespace {
+
+void check_incremental_psq(position& p, unsigned const depth) {
+  CHECK(p.psq_ == compute_psq(p));
+  if (depth == 0U) {
+    return;
+  }
+
+  std::array<move, max_moves> move_list;
+  auto const begin = &move_list[0];
+  auto const end = generate_moves(p, begin);
+  for (auto it = begin; it != end; ++it) {
+    auto const before = p.psq_;
+    auto const s = p.make_move(*it, nullptr);
+    check_incremental_psq(p, depth - 1U);
+    p.unmake_move(*it, s);
+    CHECK(p.psq_ == before);
+  }
+}
+
+}  // namespace
+
+TEST_CASE("incremental psq equals computed psq") {
+  for (auto const fen :
+       {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"}) {
+    auto p = position::from_fen(fen);
+    check_incremental_psq(p, 3U);
+  }
+}
+
+TEST_CASE("tapered eval") {
+  auto const start = position::from_fen(start_position_fen);
+  CHECK(start.psq_.phase_ == max_phase);
+  CHECK(tapered_eval(start) == 0);
+
+  // Mirrored positions evaluate the same for the side to move.
+  auto const white = position::from_fen(
+      "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+  auto const black = position::from_fen(
+      "rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R b KQkq - 4 4");
+  CHECK(tapered_eval(white) == tapered_eval(black));
+
+  // Only pawns and kings: pure endgame scores.
+  auto const pawns = position::from_fen("4k3/8/8/8/8/8/4P3/4K3 w - - 0 1");
+  CHECK(pawns.psq_.phase_ == 0);
+  CHECK(tapered_eval(pawns) == pawns.psq_.eg_);
+
+  // An extra queen is worth about a queen.
+  auto const queen =
+      position::from_fen("rnb1kbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq "
+                         "- 0 1");
+  CHECK(tapered_eval(queen) < -900);
+}
@@ -2,10 +2,13 @@
 
 #include <iostream>
 #include <set>
+#include <vector>
 
+#include "chessbot/cpu_features.h"
 #include "chessbot/generate_moves.h"
 #include "chessbot/magic.h"
 #include "chessbot/position.h"
+#include "chessbot/timing.h"
 
 using namespace chessbot;
 
@@ -64,17 +67,19 @@ TEST_CASE("blocking permutations") {
 }
 
 TEST_CASE("rook attack squares a8") {
-  auto const matches = magic_rook_attack_squares[0][0] ==
-                       ((full_rank_bitboard(R8) | full_file_bitboard(FA)) &
-                        (~rank_file_to_bitboard(R8, FA)));
+  auto const matches =
+      magic_attack_squares[get_slider_index(0U, rook_magics[0])] ==
+      ((full_rank_bitboard(R8) | full_file_bitboard(FA)) &
+       (~rank_file_to_bitboard(R8, FA)));
   CHECK(matches);
 }
 
 TEST_CASE("rook attack squares e4") {
+  auto const square_idx = cista::trailing_zeros(rank_file_to_bitboard(R4, FE));
   auto const matches =
-      magic_rook_attack_squares[cista::trailing_zeros(rank_file_to_bitboard(
-          R4, FE))][0] == ((full_rank_bitboard(R4) | full_file_bitboard(FE)) &
-                           (~rank_file_to_bitboard(R4, FE)));
+      magic_attack_squares[get_slider_index(0U, rook_magics[square_idx])] ==
+      ((full_rank_bitboard(R4) | full_file_bitboard(FE)) &
+       (~rank_file_to_bitboard(R4, FE)));
   CHECK(matches);
 }
 
@@ -83,9 +88,8 @@ TEST_CASE("rook attack squares blocked") {
   auto const occupancy =
       rank_file_to_bitboard(R5, FE) | rank_file_to_bitboard(R4, FC) |
       rank_file_to_bitboard(R4, FF) | rank_file_to_bitboard(R3, FE);
-  auto const magic_index =
-      get_magic_index(occupancy, rook_square_magic_numbers[square_idx]);
-  auto const matches = magic_rook_attack_squares[square_idx][magic_index] ==
+  auto const magic_index = get_slider_index(occupancy, rook_magics[square_idx]);
+  auto const matches = magic_attack_squares[magic_index] ==
                        (rank_file_to_bitboard(R4, FD) | occupancy);
   CHECK(matches);
 }
@@ -96,8 +100,8 @@ TEST_CASE("bishop attack squares blocked") {
       rank_file_to_bitboard(R5, FF) | rank_file_to_bitboard(R5, FD) |
       rank_file_to_bitboard(R3, FD) | rank_file_to_bitboard(R2, FG);
   auto const magic_index =
-      get_magic_index(occupancy, bishop_square_magic_numbers[square_idx]);
-  auto const matches = magic_bishop_attack_squares[square_idx][magic_index] ==
+      get_slider_index(occupancy, bishop_magics[square_idx]);
+  auto const matches = magic_attack_squares[magic_index] ==
                        (rank_file_to_bitboard(R3, FF) | occupancy);
   CHECK(matches);
 }
@@ -106,4 +110,102 @@ TEST_CASE("bishop attack squares empty occupancy") {
   CHECK(
       get_attack_squares<BISHOP>(rank_file_to_bitboard(R8, FE), bitboard{0}) ==
       (bishop_line_to_edge_bb[4][11] | bishop_line_to_edge_bb[4][13]));
+}
+
+TEST_CASE("magic table is packed") {
+  auto const table_size = [](magic const& m) {
+    return 1U << std::popcount(m.mask_);
+  };
+  for (auto i = 0U; i != 63U; ++i) {
+    CHECK(rook_magics[i].offset_ + table_size(rook_magics[i]) ==
+          rook_magics[i + 1].offset_);
+    CHECK(bishop_magics[i].offset_ + table_size(bishop_magics[i]) ==
+          bishop_magics[i + 1].offset_);
+  }
+  CHECK(rook_magics[63].offset_ + table_size(rook_magics[63]) ==
+        rook_magic_table_size);
+  CHECK(bishop_magics[0].offset_ == rook_magic_table_size);
+  CHECK(bishop_magics[63].offset_ + table_size(bishop_magics[63]) ==
+        magic_attack_squares.size());
+}
+
+void check_slider_attacks() {
+  for (auto i = 0U; i != 64U; ++i) {
+    auto const square = bitboard{1} << i;
+    auto rook_errors = 0U, bishop_errors = 0U;
+    for_all_permutations(rook_attack_bbs[i], [&](bitboard const occupancy) {
+      rook_errors += get_attack_squares<ROOK>(square, occupancy) !=
+                     rook_attack_squares(square, occupancy);
+      return false;
+    });
+    for_all_permutations(bishop_attack_bbs[i], [&](bitboard const occupancy) {
+      bishop_errors += get_attack_squares<BISHOP>(square, occupancy) !=
+                       bishop_attack_squares(square, occupancy);
+      return false;
+    });
+    CHECK(rook_errors == 0U);
+    CHECK(bishop_errors == 0U);
+  }
+}
+
+TEST_CASE("precomputed magics match ray scan") {
+  set_slider_backend(slider_backend::MAGIC);
+  check_slider_attacks();
+  set_slider_backend(default_slider_backend());
+}
+
+TEST_CASE("pext backend matches ray scan") {
+  if (!cpu_has_bmi2()) {
+    return;
+  }
+  set_slider_backend(slider_backend::PEXT);
+  check_slider_attacks();
+  set_slider_backend(default_slider_backend());
+}
+
+TEST_CASE("software pext") {
+  CHECK(pext_sw(0b1011'0110U, 0b1111'0000U) == 0b1011U);
+  CHECK(pext_sw(0b1011'0110U, 0b0101'0101U) == 0b0110U);
+  CHECK(pext_sw(~uint64_t{0U}, 0U) == 0U);
+
+  if (cpu_has_bmi2()) {
+    auto errors = 0U;
+    for (auto const& m : rook_magics) {
+      for_all_permutations(m.mask_, [&](bitboard const occupancy) {
+        errors += pext(occupancy, m.mask_) != pext_sw(occupancy, m.mask_);
+        return false;
+      });
+    }
+    CHECK(errors == 0U);
+  }
+}
+
+TEST_CASE("guess magic number") {
+  auto const square_idx = cista::trailing_zeros(rank_file_to_bitboard(R4, FE));
+  auto const square = bitboard{1} << square_idx;
+  auto m = rook_magics[square_idx];
+  m.number_ = guess_magic_number(square_idx, ROOK, m.mask_);
+  m.offset_ = 0U;
+
+  auto table = std::vector<bitboard>(1U << std::popcount(m.mask_));
+  for_all_permutations(m.mask_, [&](bitboard const occupancy) {
+    table[get_magic_index(occupancy, m)] =
+        rook_attack_squares(square, occupancy);
+    return false;
+  });
+  auto errors = 0U;
+  for_all_permutations(m.mask_, [&](bitboard const occupancy) {
+    errors += table[get_magic_index(occupancy, m)] !=
+              rook_attack_squares(square, occupancy);
+    return false;
+  });
+  CHECK(errors == 0U);
+}
+
+TEST_CASE("magic attack table startup time") {
+  CHESSBOT_START_TIMING(build_timing);
+  build_magic_attack_table();
+  CHESSBOT_STOP_TIMING(build_timing);
+  std::cout << "build magic attack table: " << CHESSBOT_TIMING_US(build_timing)
+            << "us\n";
 }
\ No newline at end of file
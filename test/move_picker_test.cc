@@ -0,0 +1,117 @@
+#include "doctest/doctest.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/move_picker.h"
+#include "chessbot/position.h"
+#include "chessbot/see.h"
+
+using namespace chessbot;
+
+namespace {
+
+constexpr char const* const fens[] = {
+    start_position_fen,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1",
+    "3k4/3Q4/8/8/8/8/8/4K3 b - - 0 1"};
+
+std::vector<move> all_moves(position const& p) {
+  std::array<move, max_moves> move_list;
+  return {&move_list[0], generate_moves(p, &move_list[0])};
+}
+
+std::vector<move> picked(move_picker& picker) {
+  auto moves = std::vector<move>{};
+  for (auto m = picker.next(); m.is_initialized(); m = picker.next()) {
+    moves.emplace_back(m);
+  }
+  return moves;
+}
+
+bool same_moves(std::vector<move> a, std::vector<move> b) {
+  auto const by_value = [](move const x, move const y) {
+    return x.to_str() < y.to_str();
+  };
+  std::sort(begin(a), end(a), by_value);
+  std::sort(begin(b), end(b), by_value);
+  return a == b;
+}
+
+}  // namespace
+
+TEST_CASE("move picker yields every legal move once") {
+  for (auto const fen : fens) {
+    auto const p = position::from_fen(fen);
+    auto const legal = all_moves(p);
+
+    auto ordering = move_ordering{};
+    auto picker = move_picker{p, move{}, &ordering, 0U};
+    CHECK(same_moves(picked(picker), legal));
+
+    // Hash move, killers and history for every legal move.
+    for (auto const hash_move : legal) {
+      ordering.update_killers(1U, legal.front());
+      ordering.update_killers(1U, legal.back());
+      ordering.update_history(p.to_move_, hash_move, 100);
+      auto with_hash = move_picker{p, hash_move, &ordering, 1U};
+      auto const moves = picked(with_hash);
+      CHECK(moves.front() == hash_move);
+      CHECK(same_moves(moves, legal));
+    }
+  }
+}
+
+TEST_CASE("move picker ignores illegal hash moves and killers") {
+  auto const p = position::from_fen(start_position_fen);
+  auto const other = position::from_fen(
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+  auto ordering = move_ordering{};
+  ordering.update_killers(0U, move{other, "e1g1"});
+  ordering.update_killers(0U, move{other, "f3f6"});
+  auto picker = move_picker{p, move{other, "e5f7"}, &ordering, 0U};
+  CHECK(same_moves(picked(picker), all_moves(p)));
+}
+
+TEST_CASE("move picker order") {
+  auto const p = position::from_fen(
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+  auto const legal = all_moves(p);
+  auto const killer = *std::find_if(begin(legal), end(legal), [](move m) {
+    return m.to_str() == "a2a3";
+  });
+  auto ordering = move_ordering{};
+  ordering.update_killers(0U, killer);
+
+  auto picker = move_picker{p, move{}, &ordering, 0U};
+  auto const moves = picked(picker);
+  auto const killer_pos = std::find(begin(moves), end(moves), killer);
+  REQUIRE(killer_pos != end(moves));
+
+  // Good captures by MVV-LVA before the killer, then quiets, then captures
+  // that lose material.
+  auto prev_mvv_lva = std::numeric_limits<score_t>::max();
+  for (auto it = begin(moves); it != killer_pos; ++it) {
+    CHECK(!is_quiet_move(p, *it));
+    CHECK(see_ge(p, *it, 0));
+    CHECK(mvv_lva(p, *it) <= prev_mvv_lva);
+    prev_mvv_lva = mvv_lva(p, *it);
+  }
+  auto it = killer_pos + 1;
+  for (; it != end(moves) && is_quiet_move(p, *it); ++it) {
+  }
+  for (; it != end(moves); ++it) {
+    CHECK(!is_quiet_move(p, *it));
+    CHECK(!see_ge(p, *it, 0));
+  }
+
+  auto captures_only = move_picker{p, move{}, nullptr, 0U, true};
+  auto const captures = picked(captures_only);
+  CHECK(std::equal(begin(captures), end(captures), begin(moves)));
+  CHECK(captures.size() == static_cast<size_t>(killer_pos - begin(moves)));
+}
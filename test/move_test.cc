@@ -10,6 +10,7 @@
 #include "chessbot/dfs.h"
 #include "chessbot/generate_moves.h"
 #include "chessbot/position.h"
+#include "chessbot/timing.h"
 
 #include "./test_position.h"
 
@@ -902,4 +903,182 @@ TEST_CASE("position 5 - pin by castle") {
       "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 "
       "10"};
   CHECK(164075551 == dfs_rec(p, 0U, 5, nullptr));
-}
\ No newline at end of file
+}
+
+void check_count_moves(position const& p, unsigned const depth) {
+  auto move_list = std::array<move, max_moves>{};
+  auto const end = generate_moves(p, &move_list[0]);
+  CHECK(count_moves(p) == static_cast<unsigned>(end - &move_list[0]));
+  if (depth == 0U) {
+    return;
+  }
+  for (auto const& m : utl::all(&move_list[0], end) | utl::iterable()) {
+    auto copy = position{p};
+    copy.make_move(m, nullptr);
+    check_count_moves(copy, depth - 1U);
+  }
+}
+
+TEST_CASE("count moves equals number of generated moves") {
+  for (auto const fen :
+       {start_position_fen,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "4q3/8/3n4/1K1Pp2r/8/8/8/1r3b1k w - e6 0 1",
+        "8/1k6/8/1K2Pp1r/7r/1n6/8/8 w - - 1 1"}) {
+    check_count_moves(position::from_fen(fen), 2U);
+  }
+}
+
+void check_unmake_move(position& p, state_info const* const info,
+                       unsigned const depth) {
+  auto const copy = p;
+  auto move_list = std::array<move, max_moves>{};
+  auto const end = generate_moves(p, &move_list[0]);
+  for (auto const& m : utl::all(&move_list[0], end) | utl::iterable()) {
+    auto const s = p.make_move(m, info);
+    if (depth != 0U) {
+      check_unmake_move(p, &s, depth - 1U);
+    }
+    p.unmake_move(m, s);
+    CHECK(p.piece_states_ == copy.piece_states_);
+    CHECK(p.pieces_by_color_ == copy.pieces_by_color_);
+    CHECK(p.checkers_ == copy.checkers_);
+    CHECK(p.blockers_for_king_ == copy.blockers_for_king_);
+    CHECK(p.pinners_ == copy.pinners_);
+    CHECK(p.hash_ == copy.hash_);
+    CHECK(p.to_fen() == copy.to_fen());
+  }
+}
+
+TEST_CASE("unmake move restores position") {
+  for (auto const fen :
+       {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+    auto p = position::from_fen(fen);
+    check_unmake_move(p, nullptr, 1U);
+  }
+}
+
+size_t dfs_copy_make(position const& p, unsigned const depth,
+                     state_info const* const info) {
+  auto move_list = std::array<move, max_moves>{};
+  auto const end = generate_moves(p, &move_list[0]);
+  if (depth == 1U) {
+    return static_cast<size_t>(end - &move_list[0]);
+  }
+  auto leaves = size_t{0U};
+  for (auto const& m : utl::all(&move_list[0], end) | utl::iterable()) {
+    auto copy = p;
+    auto const s = copy.make_move(m, info);
+    leaves += dfs_copy_make(copy, depth - 1U, &s);
+  }
+  return leaves;
+}
+
+size_t dfs_make_unmake(position& p, unsigned const depth,
+                       state_info const* const info) {
+  auto move_list = std::array<move, max_moves>{};
+  auto const end = generate_moves(p, &move_list[0]);
+  if (depth == 1U) {
+    return static_cast<size_t>(end - &move_list[0]);
+  }
+  auto leaves = size_t{0U};
+  for (auto const& m : utl::all(&move_list[0], end) | utl::iterable()) {
+    auto const s = p.make_move(m, info);
+    leaves += dfs_make_unmake(p, depth - 1U, &s);
+    p.unmake_move(m, s);
+  }
+  return leaves;
+}
+
+TEST_CASE("copy make vs make unmake") {
+  auto p = position::from_fen(
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+
+  CHESSBOT_START_TIMING(copy_make_timing);
+  auto const copy_make_leaves = dfs_copy_make(p, 4U, nullptr);
+  CHESSBOT_STOP_TIMING(copy_make_timing);
+
+  CHESSBOT_START_TIMING(make_unmake_timing);
+  auto const make_unmake_leaves = dfs_make_unmake(p, 4U, nullptr);
+  CHESSBOT_STOP_TIMING(make_unmake_timing);
+
+  CHECK(copy_make_leaves == 4085603U);
+  CHECK(make_unmake_leaves == 4085603U);
+  std::cout << "copy make: " << CHESSBOT_TIMING_MS(copy_make_timing)
+            << "ms\n";
+  std::cout << "make unmake: " << CHESSBOT_TIMING_MS(make_unmake_timing)
+            << "ms\n";
+}
+
+std::set<std::string> stage_moves(move* const begin, move* const end) {
+  auto moves = std::set<std::string>{};
+  for (auto const& m : utl::all(begin, end) | utl::iterable()) {
+    CHECK(moves.emplace(m.to_str()).second);
+  }
+  return moves;
+}
+
+void check_stages(position const& p, unsigned const depth) {
+  auto list = std::array<move, max_moves>{};
+  auto const begin = &list[0];
+
+  auto const all = stage_moves(begin, generate_moves(p, begin));
+  auto const captures =
+      stage_moves(begin, generate_moves<gen_type::CAPTURES>(p, begin));
+  auto const quiets =
+      stage_moves(begin, generate_moves<gen_type::QUIETS>(p, begin));
+  auto const evasions =
+      stage_moves(begin, generate_moves<gen_type::EVASIONS>(p, begin));
+  auto const quiet_checks =
+      stage_moves(begin, generate_moves<gen_type::QUIET_CHECKS>(p, begin));
+
+  auto captures_and_quiets = captures;
+  for (auto const& m : quiets) {
+    CHECK(captures_and_quiets.emplace(m).second);
+  }
+  CHECK(captures_and_quiets == all);
+  CHECK(evasions ==
+        (p.checkers_[p.to_move_] ? all : std::set<std::string>{}));
+
+  auto expected_quiet_checks = std::set<std::string>{};
+  auto const quiets_end = generate_moves<gen_type::QUIETS>(p, begin);
+  for (auto const& m : utl::all(begin, quiets_end) | utl::iterable()) {
+    auto copy = p;
+    copy.make_move(m, nullptr);
+    if (copy.checkers_[copy.to_move_] != 0U) {
+      expected_quiet_checks.emplace(m.to_str());
+    }
+  }
+  CHECK(quiet_checks == expected_quiet_checks);
+
+  if (depth != 0U) {
+    auto const end = generate_moves(p, begin);
+    for (auto const& m : utl::all(begin, end) | utl::iterable()) {
+      auto copy = p;
+      copy.make_move(m, nullptr);
+      check_stages(copy, depth - 1U);
+    }
+  }
+}
+
+TEST_CASE("staged move generation") {
+  for (auto const fen :
+       {start_position_fen,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "rnbqkb1r/pppppppp/B7/8/8/8/PPPPNnPP/RNBQK2R w KQkq - 0 4",
+        "r1bqkb1r/pppp1Qpp/2n2n2/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 5 3",
+        "4q3/8/3n4/1K1Pp2r/8/8/8/1r3b1k w - e6 0 1",
+        "8/1k6/8/1K2Pp1r/7r/1n6/8/8 w - - 1 1",
+        "8/k6P/8/8/8/p7/8/K6r w - - 0 2"}) {
+    check_stages(position::from_fen(fen), 1U);
+  }
+}
@@ -0,0 +1,57 @@
+#include "doctest/doctest.h"
+
+#include <cmath>
+#include <memory>
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/nn_accumulator.h"
+#include "chessbot/nn_chess.h"
+#include "chessbot/position.h"
+
+using namespace chessbot;
+
+namespace {
+
+using test_network = network<input_size, 8, 4, 16>;
+
+template <typename Network>
+void check_accumulator(Network const& nn, nn_accumulator<Network>& acc,
+                       position& p, unsigned const depth) {
+  auto const expected = nn.estimate(nn_input_from_position(p));
+  auto const actual = acc.estimate(p.to_move_);
+  for (auto i = 0U; i != expected.size(); ++i) {
+    CHECK(std::abs(expected[i] - actual[i]) < 1E-9);
+  }
+  if (depth == 0U) {
+    return;
+  }
+
+  std::array<move, max_moves> move_list;
+  auto const begin = &move_list[0];
+  auto const end = generate_moves(p, begin);
+  for (auto it = begin; it != end; ++it) {
+    acc.push(p, *it);
+    auto const s = p.make_move(*it, nullptr);
+    check_accumulator(nn, acc, p, depth - 1U);
+    p.unmake_move(*it, s);
+    acc.pop();
+  }
+}
+
+}  // namespace
+
+TEST_CASE("nn accumulator matches full estimate") {
+  for (auto const& [min, max] : {std::pair{0.0, 1.0}, std::pair{-1.0, 2.0}}) {
+    auto const nn = std::make_unique<test_network>(min, max);
+    auto acc = nn_accumulator<test_network>{*nn};
+    for (auto const fen :
+         {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+          "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+          "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1",
+          "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+      auto p = position::from_fen(fen);
+      acc.reset(p);
+      check_accumulator(*nn, acc, p, 2U);
+    }
+  }
+}
@@ -1,5 +1,6 @@
 #include "doctest/doctest.h"
 
+#include <bit>
 #include <iostream>
 
 #include "chessbot/generate_moves.h"
@@ -50,6 +51,80 @@ TEST_CASE("nn classifies legal moves - one position") {
   }
 }
 
+TEST_CASE("nn sparse input matches dense input") {
+  using net_t = network<input_size, 8, 16>;
+  auto const fens = {
+      start_position_fen,
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"};
+  for (auto const& [min, max] : {std::pair{0.0, 1.0}, std::pair{-1.0, 2.0}}) {
+    srand(0);
+    auto dense = std::make_unique<net_t>(min, max);
+    auto sparse = std::make_unique<net_t>(*dense);
+    for (auto const fen : fens) {
+      auto const p = position::from_fen(fen);
+      auto const in = nn_sparse_input_from_position(p);
+      CHECK(in.to_dense() == nn_input_from_position(p));
+      CHECK(in.size_ == static_cast<unsigned>(
+                            std::popcount(p.all_pieces())));
+
+      auto expected = net_t::output_t{};
+      for (auto& e : expected) {
+        e = static_cast<real_t>(rand()) / RAND_MAX;
+      }
+      for (auto i = 0U; i != 3U; ++i) {
+        dense->train(nn_input_from_position(p), expected, 0.3);
+        sparse->train(in, expected, 0.3);
+      }
+
+      auto const a = dense->estimate(nn_input_from_position(p));
+      auto const b = sparse->estimate(in);
+      for (auto i = 0U; i != a.size(); ++i) {
+        CHECK(std::abs(a[i] - b[i]) < 1E-9);
+      }
+    }
+  }
+}
+
+TEST_CASE("nn mini-batch training with sparse input") {
+  using net_t = network<input_size, 70, 16>;
+  constexpr auto const batch_size = 20U;
+
+  srand(0);
+  auto n = std::make_unique<net_t>();
+  auto p = position::from_fen(start_position_fen);
+  auto dense = std::array<net_t::input_t, batch_size>{};
+  auto sparse = std::array<nn_sparse_input_t, batch_size>{};
+  auto expected = std::array<net_t::output_t, batch_size>{};
+  for (auto s = 0U; s != batch_size; ++s) {
+    dense[s] = nn_input_from_position(p);
+    sparse[s] = nn_sparse_input_from_position(p);
+    for (auto& x : expected[s]) {
+      x = static_cast<real_t>(rand()) / RAND_MAX;
+    }
+    auto moves = std::array<move, max_moves>{};
+    auto const end = generate_moves(p, &moves[0]);
+    p.make_move(moves[(s * 7U) % (end - &moves[0])], nullptr);
+  }
+
+  auto b = net_t::batch{};
+  auto from_dense = std::make_unique<net_t::layers_tuple_t>();
+  n->train_batch(*from_dense, dense, expected, -1, b);
+  auto from_sparse = std::make_unique<net_t::layers_tuple_t>();
+  n->train_batch(*from_sparse, sparse, expected, -1, b);
+
+  auto const check_layer = [](auto const& a, auto const& b) {
+    for (auto i = 0U; i != a.weights_.size(); ++i) {
+      for (auto j = 0U; j != a.weights_[i].size(); ++j) {
+        CHECK(std::abs(a.weights_[i][j] - b.weights_[i][j]) < 1E-9);
+      }
+      CHECK(std::abs(a.bias_weight_[i] - b.bias_weight_[i]) < 1E-9);
+    }
+  };
+  check_layer(std::get<0>(*from_dense), std::get<0>(*from_sparse));
+  check_layer(std::get<1>(*from_dense), std::get<1>(*from_sparse));
+}
+
 TEST_CASE("nn classifies legal moves - random position" * doctest::skip(true)) {
   srand(0);
 
@@ -0,0 +1,88 @@
+#include "doctest/doctest.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "chessbot/cpu_features.h"
+#include "chessbot/generate_moves.h"
+#include "chessbot/nn_chess.h"
+#include "chessbot/nn_quantized.h"
+#include "chessbot/position.h"
+
+using namespace chessbot;
+
+namespace {
+
+using test_network = network<input_size, 16, 16, 64>;
+
+std::vector<position> test_positions() {
+  auto positions = std::vector<position>{};
+  for (auto const fen :
+       {start_position_fen,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+    auto const p = position::from_fen(fen);
+    positions.emplace_back(p);
+    std::array<move, max_moves> move_list;
+    auto const end = generate_moves(p, &move_list[0]);
+    for (auto it = &move_list[0]; it != end; ++it) {
+      positions.emplace_back(p).make_move(*it, nullptr);
+    }
+  }
+  return positions;
+}
+
+}  // namespace
+
+TEST_CASE("nn quantized network approximates float network") {
+  auto const positions = test_positions();
+  for (auto const& [min, max, weight_scale] :
+       {std::tuple{0.0, 1.0, 1.0}, std::tuple{-1.0, 2.0, 8.0}}) {
+    srand(0);
+    auto const nn = std::make_unique<test_network>(min, max);
+    for (auto& row : std::get<0>(nn->layers_).weights_) {
+      for (auto& w : row) {
+        w *= weight_scale;
+      }
+    }
+    auto const q = std::make_unique<quantized_network<test_network>>(*nn);
+
+    auto max_error = 0.0;
+    for (auto const& p : positions) {
+      auto const expected = nn->estimate(nn_input_from_position(p));
+      auto const actual = q->estimate(nn_sparse_input_from_position(p));
+      for (auto i = 0U; i != expected.size(); ++i) {
+        max_error = std::max(max_error, std::abs(expected[i] - actual[i]));
+      }
+    }
+    CHECK(max_error < 0.01 * (max - min));
+  }
+}
+
+TEST_CASE("nn quantized network backends agree") {
+  // Layer sizes that need padding.
+  using odd_network = network<input_size, 12, 10, 50>;
+  auto const positions = test_positions();
+  auto const nn = std::make_unique<odd_network>();
+  auto const q = std::make_unique<quantized_network<odd_network>>(*nn);
+
+  auto const estimate_all = [&](simd_backend const b) {
+    active_simd_backend = b;
+    auto out = std::vector<odd_network::output_t>{};
+    for (auto const& p : positions) {
+      out.emplace_back(q->estimate(nn_sparse_input_from_position(p)));
+    }
+    return out;
+  };
+
+  auto const scalar = estimate_all(simd_backend::SCALAR);
+  if (cpu_has_ssse3()) {
+    CHECK(estimate_all(simd_backend::SSSE3) == scalar);
+  }
+  if (cpu_has_avx2()) {
+    CHECK(estimate_all(simd_backend::AVX2) == scalar);
+  }
+  active_simd_backend = default_simd_backend();
+}
@@ -378,3 +378,89 @@ TEST_CASE("nn test epoch") {
 
   CHECK(err < 0.0001);
 }
+
+TEST_CASE("nn mini-batch training matches per-sample training") {
+  // Batch size not divisible by the block size.
+  using net_t = network<100, 70, 3>;
+  constexpr auto const batch_size = 37U;
+
+  srand(0);
+  auto n = std::make_unique<net_t>(-1.0, 2.0);
+  auto in = std::array<net_t::input_t, batch_size>{};
+  auto expected = std::array<net_t::output_t, batch_size>{};
+  for (auto s = 0U; s != batch_size; ++s) {
+    for (auto& x : in[s]) {
+      x = 3.0 * rand() / RAND_MAX - 1.0;
+    }
+    for (auto& x : expected[s]) {
+      x = 3.0 * rand() / RAND_MAX - 1.0;
+    }
+  }
+
+  auto per_sample = std::make_unique<net_t::layers_tuple_t>();
+  for (auto s = 0U; s != batch_size; ++s) {
+    n->train(*per_sample, in[s], expected[s], -1);
+  }
+
+  auto batched = std::make_unique<net_t::layers_tuple_t>();
+  auto b = net_t::batch{};
+  n->train_batch(*batched, in, expected, -1, b);
+
+  auto const check_layer = [](auto const& a, auto const& b) {
+    for (auto i = 0U; i != a.weights_.size(); ++i) {
+      for (auto j = 0U; j != a.weights_[i].size(); ++j) {
+        CHECK(std::abs(a.weights_[i][j] - b.weights_[i][j]) < 1E-9);
+      }
+      CHECK(std::abs(a.bias_weight_[i] - b.bias_weight_[i]) < 1E-9);
+    }
+  };
+  check_layer(std::get<0>(*per_sample), std::get<0>(*batched));
+  check_layer(std::get<1>(*per_sample), std::get<1>(*batched));
+}
+
+TEST_CASE("nn multithreaded training is deterministic") {
+  using net_t = network<100, 70, 3>;
+  constexpr auto const batch_size = 37U;
+
+  srand(0);
+  auto const initial = std::make_unique<net_t>(-1.0, 2.0);
+  auto in = std::array<net_t::input_t, batch_size>{};
+  auto expected = std::array<net_t::output_t, batch_size>{};
+  for (auto s = 0U; s != batch_size; ++s) {
+    for (auto& x : in[s]) {
+      x = 3.0 * rand() / RAND_MAX - 1.0;
+    }
+    for (auto& x : expected[s]) {
+      x = 3.0 * rand() / RAND_MAX - 1.0;
+    }
+  }
+
+  auto const train = [&](unsigned const n_threads) {
+    auto n = std::make_unique<net_t>(*initial);
+    n->train_epoch(in, expected, 0.1, 5, [](unsigned) {}, n_threads);
+    return n;
+  };
+
+  auto const single = train(1U);
+  auto const multi = train(5U);
+  auto const check_layer = [](auto const& a, auto const& b) {
+    for (auto i = 0U; i != a.weights_.size(); ++i) {
+      for (auto j = 0U; j != a.weights_[i].size(); ++j) {
+        CHECK(std::abs(a.weights_[i][j] - b.weights_[i][j]) < 1E-9);
+      }
+      CHECK(std::abs(a.bias_weight_[i] - b.bias_weight_[i]) < 1E-9);
+    }
+  };
+  check_layer(std::get<0>(single->layers_), std::get<0>(multi->layers_));
+  check_layer(std::get<1>(single->layers_), std::get<1>(multi->layers_));
+
+  for (auto run = 0U; run != 3U; ++run) {
+    auto const again = train(5U);
+    CHECK(std::get<0>(again->layers_).weights_ ==
+          std::get<0>(multi->layers_).weights_);
+    CHECK(std::get<1>(again->layers_).weights_ ==
+          std::get<1>(multi->layers_).weights_);
+    CHECK(std::get<1>(again->layers_).bias_weight_ ==
+          std::get<1>(multi->layers_).bias_weight_);
+  }
+}
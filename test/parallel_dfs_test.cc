@@ -0,0 +1,43 @@
+#include "doctest/doctest.h"
+
+#include "chessbot/dfs.h"
+#include "chessbot/parallel_dfs.h"
+#include "chessbot/position.h"
+
+#include "./test_position.h"
+
+using namespace chessbot;
+
+TEST_CASE("parallel dfs kiwipete") {
+  auto p = test_position{
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"};
+  auto divide = divide_t{};
+  CHECK(4085603 == parallel_dfs(p, 4U, nullptr, 4U, divide, nullptr, 2U));
+  CHECK(divide.size() == 48U);
+}
+
+TEST_CASE("parallel dfs divide matches single threaded") {
+  auto p = test_position{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"};
+  p.make_move("c4c5");
+
+  auto divide = divide_t{};
+  auto const leaves = parallel_dfs(p, 4U, p.states_.back().get(), 3U, divide);
+
+  auto sum = size_t{0U};
+  for (auto const& [m, m_leaves] : divide) {
+    auto copy = position{p};
+    auto const s = copy.make_move(m, p.states_.back().get());
+    CHECK(m_leaves == dfs_rec(copy, 1U, 4U, &s));
+    sum += m_leaves;
+  }
+  CHECK(sum == leaves);
+  CHECK(leaves == dfs_rec(p, 0U, 4U, p.states_.back().get()));
+}
+
+TEST_CASE("parallel dfs depth 1") {
+  auto p = test_position{start_position_fen};
+  auto divide = divide_t{};
+  CHECK(20U == parallel_dfs(p, 1U, nullptr, 2U, divide));
+  CHECK(divide.size() == 20U);
+}
@@ -115,4 +115,43 @@ TEST_CASE("fen output") {
   in >> p;
 
   CHECK(p.to_fen() == std::string{start_position_fen});
+}
+
+TEST_CASE("allocation-free fen round trip") {
+  for (auto const fen : {
+           std::string_view{start_position_fen},
+           std::string_view{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/"
+                            "PPPBBPPP/R3K2R w KQkq - 0 1"},
+           std::string_view{"2k5/8/2K5/R5p1/2P5/8/R1P5/8 w - g6 0 2"},
+           std::string_view{"8/3P4/8/k4p2/8/6P1/3K3P/1q2q3 w - - 17 151"},
+       }) {
+    auto const p = position::parse_fen(fen, true);
+    char buf[position::max_fen_length];
+    auto const end = p.to_fen(buf);
+    CHECK(std::string_view{buf, static_cast<size_t>(end - buf)} == fen);
+    CHECK(*end == '\0');
+
+    auto const streamed = position::from_fen(std::string{fen});
+    CHECK(p.hash_ == streamed.hash_);
+    CHECK(p.to_fen() == streamed.to_fen());
+  }
+}
+
+TEST_CASE("read fen returns the remaining text") {
+  auto p = position{};
+  CHECK(p.read_fen("4k3/8/8/8/8/8/8/4K2R w K - e2e4 31") == " e2e4 31");
+  CHECK(p.half_move_clock_ == 0U);
+  CHECK(p.castling_rights_.white_can_short_castle_);
+  CHECK(p.read_fen("4k3/8/8/8/8/8/8/4K2R b - - 3 40 e2e4 31") == " e2e4 31");
+  CHECK(p.half_move_clock_ == 3U);
+  CHECK(p.full_move_count_ == 40U);
+  CHECK(!p.castling_rights_.white_can_short_castle_);
+}
+
+TEST_CASE("parse fen rejects invalid input") {
+  CHECK_THROWS(position::parse_fen("4k3/8/8/8/8/8/8/4X3 w - - 0 1"));
+  CHECK_THROWS(position::parse_fen("4k3/8/8/8/8/8/8/4K3 x - - 0 1"));
+  CHECK_THROWS(position::parse_fen("4k3/8/8/8/8/8/8/4K3 w KX - 0 1"));
+  CHECK_THROWS(position::parse_fen("4k3/8/8/8/8/8/8/4K3 w - j9 0 1"));
+  CHECK_THROWS(position::parse_fen("4k3/8/8/8/8/8/8/8/4K3 w - - 0 1"));
 }
\ No newline at end of file
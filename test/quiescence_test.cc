@@ -0,0 +1,73 @@
+#include "doctest/doctest.h"
+
+#include <algorithm>
+
+#include "chessbot/position.h"
+#include "chessbot/quiescence.h"
+#include "chessbot/search.h"
+
+using namespace chessbot;
+
+TEST_CASE("quiescence quiet position") {
+  auto const p = position::from_fen(start_position_fen);
+  CHECK(quiesce(p) == 0);
+  CHECK(is_quiet(p));
+}
+
+TEST_CASE("quiescence resolves captures") {
+  auto const after = [](position p, char const* m) {
+    p.make_move(move{p, m}, nullptr);
+    return p;
+  };
+
+  // Rxd5 wins the queen.
+  auto const hanging = position::from_fen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1");
+  CHECK(static_eval(hanging) < -300);
+  CHECK(quiesce(hanging) == -static_eval(after(hanging, "d2d5")));
+  CHECK(quiesce(hanging) > 300);
+  CHECK(!is_quiet(hanging, 100));
+
+  // Qxd5 cxd5 loses the queen: stand pat.
+  auto const defended =
+      position::from_fen("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1");
+  CHECK(quiesce(defended) == static_eval(defended));
+  CHECK(is_quiet(defended));
+
+  // Black takes, white may recapture or stand pat.
+  auto const trade =
+      position::from_fen("4k3/8/8/4p3/3P4/2P5/8/4K3 b - - 0 1");
+  auto const taken = after(trade, "e5d4");
+  auto const retaken = after(taken, "c3d4");
+  CHECK(quiesce(trade) ==
+        std::max(static_eval(trade),
+                 std::min(-static_eval(taken), static_eval(retaken))));
+}
+
+TEST_CASE("quiescence check evasions") {
+  auto const mated = position::from_fen("R5k1/5ppp/8/8/8/8/8/6K1 b - - 1 1");
+  CHECK(quiesce(mated) == -mate_score);
+  CHECK(!is_quiet(mated, 10000));
+
+  // Only Kxd7 escapes the check.
+  auto p = position::from_fen("3k4/3Q4/8/8/8/8/8/4K3 b - - 0 1");
+  auto const escape = p;
+  p.make_move(move{p, "d8d7"}, nullptr);
+  CHECK(quiesce(escape) == -static_eval(p));
+}
+
+TEST_CASE("quiescence node limit") {
+  auto p = position::from_fen(
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+  auto const hash = p.hash_;
+  auto nodes = size_t{0U};
+  quiesce(p, -infinite_score, infinite_score, 0U, nodes, 10U);
+  CHECK(nodes <= 10U);
+  CHECK(p.hash_ == hash);
+}
+
+TEST_CASE("search with quiescence avoids horizon captures") {
+  auto const r = search(
+      position::from_fen("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1"), nullptr,
+      {.max_depth_ = 1U});
+  CHECK(r.best_move_.to_str() != "d1d5");
+}
@@ -0,0 +1,179 @@
+#include "doctest/doctest.h"
+
+#include "chessbot/position.h"
+#include "chessbot/search.h"
+
+using namespace chessbot;
+
+namespace {
+
+search_result search_fen(char const* fen, search_limits const& limits) {
+  return search(position::from_fen(fen), nullptr, limits);
+}
+
+}  // namespace
+
+TEST_CASE("search finds mate in one") {
+  auto const back_rank =
+      search_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", {.max_depth_ = 4U});
+  CHECK(back_rank.best_move_.to_str() == "a1a8");
+  CHECK(back_rank.score_ == mate_score - 1);
+
+  auto const scholars_mate = search_fen(
+      "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+      {.max_depth_ = 3U});
+  CHECK(scholars_mate.best_move_.to_str() == "h5f7");
+  CHECK(scholars_mate.score_ == mate_score - 1);
+}
+
+TEST_CASE("search finds mate in two") {
+  auto const r =
+      search_fen("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1", {.max_depth_ = 5U});
+  CHECK(r.best_move_.to_str() == "a1a6");
+  CHECK(r.score_ == mate_score - 3);
+  CHECK(r.pv_.size() == 3U);
+}
+
+TEST_CASE("search wins material") {
+  auto const r =
+      search_fen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1", {.max_depth_ = 3U});
+  CHECK(r.best_move_.to_str() == "d2d5");
+  CHECK(r.score_ > 0);
+}
+
+TEST_CASE("search stalemate") {
+  auto const r =
+      search_fen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", {.max_depth_ = 3U});
+  CHECK(r.score_ == 0);
+  CHECK(r.pv_.empty());
+}
+
+TEST_CASE("search limits") {
+  auto iterations = 0U;
+  auto const by_depth =
+      search(position::from_fen(start_position_fen), nullptr,
+             {.max_depth_ = 4U}, [&](search_result const& r) {
+               ++iterations;
+               CHECK(r.depth_ == iterations);
+               CHECK(r.pv_.size() == r.depth_);
+             });
+  CHECK(iterations == 4U);
+  CHECK(by_depth.depth_ == 4U);
+
+  auto const by_nodes =
+      search_fen(start_position_fen, {.max_nodes_ = 5000U});
+  CHECK(by_nodes.nodes_ <= 5000U);
+  CHECK(by_nodes.depth_ >= 1U);
+  CHECK(by_nodes.best_move_.is_initialized());
+
+  auto const by_time = search_fen(
+      start_position_fen, {.max_time_ = std::chrono::milliseconds{50}});
+  CHECK(by_time.time_us_ < 1000000);
+  CHECK(by_time.depth_ >= 1U);
+}
+
+TEST_CASE("transposition table store and probe") {
+  auto tt = transposition_table{1U};
+  auto const p = position::from_fen(start_position_fen);
+  auto const m = move{p, "g1f3"};
+
+  auto d = tt_data{};
+  CHECK(!tt.probe(p.hash_, d));
+
+  tt.store(p.hash_, m, -12345, 7U, bound::LOWER);
+  REQUIRE(tt.probe(p.hash_, d));
+  CHECK(d.move_ == m);
+  CHECK(d.score_ == -12345);
+  CHECK(d.depth_ == 7U);
+  CHECK(d.bound_ == bound::LOWER);
+
+  // An update without a best move keeps the stored one.
+  tt.store(p.hash_, move{}, 10, 8U, bound::UPPER);
+  REQUIRE(tt.probe(p.hash_, d));
+  CHECK(d.move_ == m);
+  CHECK(d.score_ == 10);
+  CHECK(d.bound_ == bound::UPPER);
+
+  // Five positions in the same bucket: the shallowest entry is replaced.
+  auto const bucket_stride = tt.size() / transposition_table::bucket_size;
+  for (auto i = 1U; i != 5U; ++i) {
+    tt.store(p.hash_ + i * bucket_stride, m, 0, 10U + i, bound::EXACT);
+  }
+  CHECK(!tt.probe(p.hash_, d));
+  for (auto i = 1U; i != 5U; ++i) {
+    CHECK(tt.probe(p.hash_ + i * bucket_stride, d));
+  }
+
+  // Entries of an older search are replaced before deeper current ones.
+  tt.new_search();
+  CHECK(tt.hashfull() == 0U);
+  tt.store(p.hash_, m, 0, 1U, bound::EXACT);
+  CHECK(tt.probe(p.hash_, d));
+  CHECK(!tt.probe(p.hash_ + bucket_stride, d));
+
+  tt.clear();
+  CHECK(!tt.probe(p.hash_, d));
+}
+
+TEST_CASE("search with transposition table") {
+  auto tt = transposition_table{4U};
+  auto const p = position::from_fen("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1");
+  for (auto const n_threads : {1U, 3U}) {
+    tt.clear();
+    auto const r =
+        search(p, nullptr, {.max_depth_ = 5U}, {}, &tt, n_threads);
+    CHECK(r.best_move_.to_str() == "a1a6");
+    CHECK(r.score_ == mate_score - 3);
+  }
+
+  // Same best move and score with and without the table.
+  auto const fen =
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+  tt.clear();
+  auto const without_tt =
+      search(position::from_fen(fen), nullptr, {.max_depth_ = 4U});
+  auto const with_tt =
+      search(position::from_fen(fen), nullptr, {.max_depth_ = 4U}, {}, &tt);
+  CHECK(with_tt.score_ == without_tt.score_);
+  CHECK(with_tt.nodes_ < without_tt.nodes_);
+
+  auto const smp = search(position::from_fen(fen), nullptr,
+                          {.max_depth_ = 4U}, {}, &tt, 4U);
+  CHECK(smp.depth_ == 4U);
+  CHECK(smp.best_move_.is_initialized());
+}
+
+TEST_CASE("search options") {
+  auto const all_off = search_options{.null_move_ = false,
+                                      .lmr_ = false,
+                                      .futility_ = false,
+                                      .razoring_ = false};
+
+  // Selectivity must not hide short mates.
+  auto const zugzwang = position::from_fen("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1");
+  for (auto const& options : {search_options{}, all_off}) {
+    auto const r = search(zugzwang, nullptr, {.max_depth_ = 5U}, {}, nullptr,
+                          1U, options);
+    CHECK(r.best_move_.to_str() == "a1a6");
+    CHECK(r.score_ == mate_score - 3);
+  }
+
+  auto const p = position::from_fen(
+      "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 "
+      "10");
+  auto const full = search(p, nullptr, {.max_depth_ = 5U}, {}, nullptr, 1U,
+                           all_off);
+  auto const selective = search(p, nullptr, {.max_depth_ = 5U});
+  CHECK(selective.nodes_ < full.nodes_);
+  for (auto i = 0U; i != 4U; ++i) {
+    auto options = all_off;
+    (i == 0U   ? options.null_move_
+     : i == 1U ? options.lmr_
+     : i == 2U ? options.futility_
+               : options.razoring_) = true;
+    auto const r =
+        search(p, nullptr, {.max_depth_ = 5U}, {}, nullptr, 1U, options);
+    CHECK(r.depth_ == 5U);
+    CHECK(r.nodes_ < full.nodes_);
+  }
+}
@@ -0,0 +1,80 @@
+#include "doctest/doctest.h"
+
+#include <string>
+
+#include "chessbot/generate_moves.h"
+#include "chessbot/position.h"
+#include "chessbot/see.h"
+
+using namespace chessbot;
+
+namespace {
+
+struct see_case {
+  char const* fen_;
+  char const* move_;
+  score_t see_;
+};
+
+// Values with P=100, N=320, B=330, R=500, Q=900.
+constexpr see_case const see_cases[] = {
+    // undefended pawn
+    {"4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 100},
+    // pawn for pawn
+    {"4k3/8/2p5/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 0},
+    {"4k3/8/8/4p3/3P4/2P5/8/4K3 b - - 0 1", "e5d4", 0},
+    // knight for pawn
+    {"4k3/8/2p5/3p4/8/4N3/8/4K3 w - - 0 1", "e3d5", -220},
+    // rook x-rays through the rook in front: R for 2P
+    {"4k3/8/2p5/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", -300},
+    // queen x-rays through the bishop: B for N + P
+    {"4k3/8/4p3/3n4/8/1B6/Q7/4K3 w - - 0 1", "b3d5", 90},
+    // RxP RxR QxR
+    {"3r2k1/8/8/3p4/8/8/3R4/3QK3 w - - 0 1", "d2d5", 100},
+    // the knight on c7 is pinned to its king
+    {"1k6/2n5/8/3pB3/8/2N5/8/4K3 w - - 0 1", "c3d5", 100},
+    {"1k6/2n5/8/3p4/8/2N5/8/4K3 w - - 0 1", "c3d5", -220},
+    // the king may only recapture on an undefended square
+    {"8/8/4k3/3p4/4P3/8/8/3RK3 w - - 0 1", "e4d5", 100},
+    {"8/8/4k3/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 0},
+    // en passant
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},
+    // capture promotion, the king takes the new queen
+    {"2kr4/4P3/8/8/8/8/8/4K3 w - - 0 1", "e7d8q", 400},
+    // quiet moves, the king takes back the pawn
+    {"4k3/8/8/8/8/2p5/8/3QK3 w - - 0 1", "d1d2", -800},
+    {"4k3/8/8/8/8/2p5/8/3QK3 w - - 0 1", "d1a4", 0},
+    {"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "e1g1", 0},
+};
+
+}  // namespace
+
+TEST_CASE("see known positions") {
+  for (auto const& c : see_cases) {
+    auto const p = position::from_fen(c.fen_);
+    auto const m = move{p, c.move_};
+    CHECK(see(p, m) == c.see_);
+    CHECK(see_ge(p, m, c.see_));
+    CHECK(!see_ge(p, m, c.see_ + 1));
+  }
+}
+
+TEST_CASE("see_ge matches see") {
+  for (auto const fen :
+       {start_position_fen,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - "
+        "0 10"}) {
+    auto const p = position::from_fen(fen);
+    std::array<move, max_moves> move_list;
+    auto const end = generate_moves(p, &move_list[0]);
+    for (auto it = &move_list[0]; it != end; ++it) {
+      auto const value = see(p, *it);
+      CHECK(see_ge(p, *it, value));
+      CHECK(see_ge(p, *it, value - 1));
+      CHECK(!see_ge(p, *it, value + 1));
+    }
+  }
+}
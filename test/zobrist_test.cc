@@ -6,8 +6,12 @@
 #include <vector>
 
 #include "chessbot/constants.h"
+#include "chessbot/dfs.h"
 #include "chessbot/generate_moves.h"
+#include "chessbot/history.h"
+#include "chessbot/perft_table.h"
 #include "chessbot/position.h"
+#include "chessbot/zobrist.h"
 
 #include "./test_position.h"
 
@@ -85,3 +89,104 @@ TEST_CASE("check repetition castling") {
   p.make_move("b8a8");
   CHECK(p.count_repetitions() == 1);
 }
+
+void check_incremental_hash(position const& p, unsigned const depth) {
+  CHECK(p.hash_ == compute_hash(p));
+  if (depth == 0U) {
+    return;
+  }
+
+  std::array<move, max_moves> move_list;
+  auto const begin = &move_list[0];
+  auto const end = generate_moves(p, begin);
+  for (auto it = begin; it != end; ++it) {
+    auto copy = p;
+    copy.make_move(*it, nullptr);
+    check_incremental_hash(copy, depth - 1U);
+  }
+}
+
+TEST_CASE("incremental hash equals computed hash") {
+  check_incremental_hash(
+      position::from_fen(
+          "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"),
+      3U);
+  check_incremental_hash(
+      position::from_fen(
+          "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"),
+      3U);
+}
+
+TEST_CASE("perft with transposition table") {
+  auto p = test_position{
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"};
+  auto table = perft_table{1U};
+  CHECK(4085603 == dfs_rec(p, 0U, 4U, nullptr, &table));
+  CHECK(4085603 == dfs_rec(p, 0U, 4U, nullptr, &table));
+}
+
+TEST_CASE("history repetitions match state_info chain") {
+  auto p = test_position{start_position_fen};
+  p.make_move("e2e4");
+  p.make_move("e7e5");
+
+  // Start the history from the state_info chain of a game in progress.
+  auto pos = position{p};
+  auto const root_fen = pos.to_fen();
+  auto h = history{pos, p.states_.back().get(), 64U};
+  CHECK(h.count_repetitions(pos) == p.count_repetitions());
+
+  auto const push = [&](std::string const& m) {
+    h.push(pos, move{pos, m});
+    p.make_move(m);
+    CHECK(pos.hash_ == p.hash_);
+    CHECK(h.last_state()->prev_state_info_ != nullptr);
+    CHECK(h.count_repetitions(pos) == p.count_repetitions());
+  };
+  for (auto i = 0U; i != 3U; ++i) {
+    push("g1f3");
+    push("b8c6");
+    push("f3g1");
+    push("c6b8");
+  }
+  // The root had an en passant square, so it is not part of the repetitions.
+  CHECK(h.count_repetitions(pos) == 2U);
+
+  // Copies relink their states and can be popped independently.
+  auto copy = h;
+  CHECK(copy.last_state() == &copy.states_.back());
+  CHECK(copy.states_.front().prev_state_info_ == p.states_[1].get());
+  auto copy_pos = pos;
+  while (!copy.empty()) {
+    copy.pop(copy_pos);
+  }
+  CHECK(copy_pos.to_fen() == root_fen);
+  CHECK(copy_pos.hash_ == h.hashes_.front());
+
+  h.pop(pos);
+  CHECK(h.count_repetitions(pos) == 2U);
+}
+
+TEST_CASE("null move") {
+  auto p = position::from_fen("4k3/8/8/3pP3/8/8/8/R3K3 w Q d6 0 1");
+  auto const before = p;
+  auto const s = p.make_null_move(nullptr);
+  CHECK(p.to_move_ == color::BLACK);
+  CHECK(p.en_passant_ == 0U);
+  CHECK(p.half_move_clock_ == 1U);
+  CHECK(p.hash_ == compute_hash(p));
+  CHECK(!s.last_move_.is_initialized());
+
+  p.unmake_null_move(s);
+  CHECK(p.hash_ == before.hash_);
+  CHECK(p.en_passant_ == before.en_passant_);
+  CHECK(p.to_fen() == before.to_fen());
+
+  auto h = history{p, nullptr, 4U};
+  h.push_null(p);
+  h.push(p, move{p, "e8d8"});
+  h.pop(p);
+  h.pop(p);
+  CHECK(p.hash_ == before.hash_);
+  CHECK(p.to_fen() == before.to_fen());
+}